@@ -0,0 +1,209 @@
+#include "Bitboard.h"
+
+bitboard PawnAttacks[2][64];
+bitboard KnightAttacks[64];
+bitboard KingAttacks[64];
+
+magic BishopMagics[64];
+magic RookMagics[64];
+
+bitboard Between[64][64];
+bitboard Line[64][64];
+
+// Общие массивы вариантов атак для всех клеток: 5248 для слона и 102400 для ладьи
+static bitboard BishopTable[0x1480];
+static bitboard RookTable[0x19000];
+
+// Луч от клетки в направлении (dh, dv) до первой занятой клетки включительно
+// Медленный обход по клеткам используется только при заполнении таблиц
+static bitboard ray_attacks (int sq, bitboard occupied, int dh, int dv)
+{
+    bitboard attacks = 0;
+    int h = square_hor(sq) + dh;
+    int v = square_vert(sq) + dv;
+
+    for (; h >= 0 && h < Gridsize && v >= 0 && v < Gridsize; h += dh, v += dv){
+        attacks |= square_bb(make_square(h, v));
+        if (occupied & square_bb(make_square(h, v)))
+            break;
+    }
+    return attacks;
+}
+
+// Атаки по всем направлениям из списка
+static bitboard slider_attacks (int sq, bitboard occupied, const int (*Directions)[2])
+{
+    bitboard attacks = 0;
+
+    for (int i = 0; i < 4; i++)
+        attacks |= ray_attacks(sq, occupied, Directions[i][0], Directions[i][1]);
+    return attacks;
+}
+
+static const int BishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const int RookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+// Поиск и проверка магических чисел нужны только без PEXT: с ним номер ячейки берется прямо из занятости лучей
+#ifndef USE_PEXT
+
+// Генератор псевдослучайных чисел для поиска магических чисел, начальное значение постоянно,
+// чтобы таблицы строились одинаково и за одно и то же время при каждом запуске
+static bitboard random_magic ()
+{
+    static uint64_t State = 0x2545F4914F6CDD1DULL;
+    bitboard r = 0;
+
+    // Магические числа с малым количеством единиц находятся быстрее, поэтому три случайных числа объединяются по И
+    for (int i = 0; i < 3; i++){
+        State ^= State >> 12;
+        State ^= State << 25;
+        State ^= State >> 27;
+        r = (i == 0) ? State * 0x2545F4914F6CDD1DULL : r & (State * 0x2545F4914F6CDD1DULL);
+    }
+    return r;
+}
+
+#endif
+
+// Магические числа, заранее найденные перебором random_magic(). При запуске они только проверяются,
+// и перебор выполняется заново лишь для клетки, на которой число не подошло
+static const bitboard BishopMagicNumbers[64] = {
+    0x0020428400408200ULL, 0x2008010104210004ULL, 0x02D0009200480190ULL, 0x0018158B00010100ULL,
+    0x02C4042132048008ULL, 0x020082202000C221ULL, 0x4000421050080009ULL, 0x0210140202022020ULL,
+    0x00C0101410042248ULL, 0x0405204800D48080ULL, 0x3800C89200420002ULL, 0x180844124A020440ULL,
+    0x04403410A8002221ULL, 0x4040209004200400ULL, 0x084004020202A204ULL, 0x3010002104022000ULL,
+    0x00200240A9110900ULL, 0x2302800404080210ULL, 0x0204188800240010ULL, 0x8048000C01401200ULL,
+    0x120C001A11040900ULL, 0x0000401200500440ULL, 0x00004040840420A0ULL, 0x0020930822880804ULL,
+    0x4044401090900161ULL, 0x0034100015210804ULL, 0x8004100009010120ULL, 0x48C8080000820500ULL,
+    0x0080848004002000ULL, 0x0801004012005044ULL, 0x000080902C040400ULL, 0x0004009005004100ULL,
+    0x0B103010048A0200ULL, 0x8004100203181A00ULL, 0x0800140200100080ULL, 0x8401010800910040ULL,
+    0x0840010011290040ULL, 0x40100214202E1000ULL, 0x0842040040010840ULL, 0x0028010040010860ULL,
+    0x00080202A2051000ULL, 0x4200841008084204ULL, 0x0021120110000D02ULL, 0x48C1004208000084ULL,
+    0x0010088100414400ULL, 0x0021101000420580ULL, 0x0010040558401410ULL, 0x200C0C82A1050205ULL,
+    0x0011108820088000ULL, 0x0001011910120402ULL, 0x1580008608091248ULL, 0x8010018020880C02ULL,
+    0x20A1101032088480ULL, 0x0080100408082800ULL, 0x28100401140401C0ULL, 0x8002102200930012ULL,
+    0x4001040082080200ULL, 0x082200A498081808ULL, 0x000508610080D003ULL, 0x0052020044842402ULL,
+    0x4800A00140C84840ULL, 0x5000000848080820ULL, 0x0101086004240040ULL, 0x0028280808005014ULL
+};
+
+static const bitboard RookMagicNumbers[64] = {
+    0x008000908064C000ULL, 0x0040200040001000ULL, 0x0180100080A0010AULL, 0x8880041000800800ULL,
+    0x1200100201200804ULL, 0x0200020004011008ULL, 0x2180010000800600ULL, 0x0200005088210204ULL,
+    0x0400800040008021ULL, 0x0400400020005000ULL, 0x8240801000200080ULL, 0x8611001004200900ULL,
+    0x008180800C001800ULL, 0x0100800200800400ULL, 0x0A02000102000408ULL, 0x8020802300104280ULL,
+    0x0080004000402000ULL, 0xE010104000402000ULL, 0x0800808010002000ULL, 0xA280210008100100ULL,
+    0x0001818014000800ULL, 0xA002010100080400ULL, 0x0080240001020870ULL, 0x0001020004048845ULL,
+    0x0081826280004004ULL, 0x2020810900284000ULL, 0x0200100080802000ULL, 0x0200080080100080ULL,
+    0x8083080100100500ULL, 0x4406000901000400ULL, 0x0005020080800100ULL, 0x0090204200008114ULL,
+    0x0010400094800420ULL, 0x0900804000802002ULL, 0x0201001841002000ULL, 0x4100080080801000ULL,
+    0x4540040080800800ULL, 0x0002001004040020ULL, 0x0281195814001002ULL, 0x1240800040800100ULL,
+    0x0880042000524004ULL, 0x02C080410206002CULL, 0x0801200241050010ULL, 0x8400080010008080ULL,
+    0x0008000500090010ULL, 0x0082009084020008ULL, 0x4012000108020004ULL, 0x9000104D08860004ULL,
+    0x2004204114800100ULL, 0x0148802112400300ULL, 0x0202842000100880ULL, 0x001B080080900080ULL,
+    0x001A002008100600ULL, 0x0004008004020080ULL, 0x5181000600040300ULL, 0x0000044401128A00ULL,
+    0x8044110480002441ULL, 0x2008110084402202ULL, 0x90806005090010C1ULL, 0x000420310A004A42ULL,
+    0x0023001004020801ULL, 0x0882001008040102ULL, 0x000230088118020CULL, 0x0000019025040042ULL
+};
+
+#ifndef USE_PEXT
+
+// Проверка магического числа с заполнением таблицы атак клетки
+// Epoch отмечает ячейки, заполненные в текущей попытке Attempt, чтобы не очищать таблицу перед каждой попыткой
+static bool magic_fits (magic& M, const bitboard* Occupancy, const bitboard* Reference, int Size, int* Epoch, int Attempt)
+{
+    for (int i = 0; i < Size; i++){
+        unsigned idx = M.index(Occupancy[i]);
+
+        if (Epoch[idx] < Attempt){
+            Epoch[idx] = Attempt;
+            M.Attacks[idx] = Reference[i];
+        }
+        else if (M.Attacks[idx] != Reference[i])
+            return false;
+    }
+    return true;
+}
+
+#endif
+
+// Заполнение магических таблиц одного типа фигур
+// Для каждой клетки перебираются все варианты занятости лучей, и подбирается число, при умножении
+// на которое разные варианты с разными атаками не попадают в одну ячейку таблицы
+// Known - заранее найденные магические числа, в сборке с PEXT не используются
+static void init_magics (magic* Magics, bitboard* Table, const int (*Directions)[2], [[maybe_unused]] const bitboard* Known)
+{
+#ifndef USE_PEXT
+    bitboard Occupancy[4096], Reference[4096];
+    int Epoch[4096] = {}, Attempt = 0;
+#endif
+    bitboard* Attacks = Table;
+
+    for (int sq = 0; sq < 64; sq++){
+        magic& M = Magics[sq];
+
+        // Крайние клетки луча не влияют на атаки и в маску не входят
+        bitboard Edges = ((Rank1 | Rank8) & ~(Rank1 << (8 * square_vert(sq))))
+                       | ((FileA | FileH) & ~(FileA << square_hor(sq)));
+        M.Mask = slider_attacks(sq, 0, Directions) & ~Edges;
+        M.Shift = 64 - pop_count(M.Mask);
+        M.Attacks = Attacks;
+
+        // Перебор всех подмножеств маски
+        int Size = 0;
+        bitboard b = 0;
+        do {
+#ifdef USE_PEXT
+            M.Attacks[_pext_u64(b, M.Mask)] = slider_attacks(sq, b, Directions);
+#else
+            Occupancy[Size] = b;
+            Reference[Size] = slider_attacks(sq, b, Directions);
+#endif
+            Size++;
+            b = (b - M.Mask) & M.Mask;
+        } while (b);
+
+        Attacks += Size;
+
+#ifndef USE_PEXT
+        // Сначала проверяется заранее найденное число, при неудаче перебираются случайные
+        for (M.Magic = Known[sq]; !magic_fits(M, Occupancy, Reference, Size, Epoch, ++Attempt); )
+            do
+                M.Magic = random_magic();
+            while (pop_count((M.Mask * M.Magic) >> 56) < 6);
+#endif
+    }
+}
+
+// Заполнение таблиц атак
+void init_bitboards ()
+{
+    for (int sq = 0; sq < 64; sq++){
+        bitboard b = square_bb(sq);
+        bitboard One = shift_left(b) | shift_right(b);
+        bitboard Two = shift_left(shift_left(b)) | shift_right(shift_right(b));
+        bitboard Row = b | One;
+
+        PawnAttacks[White][sq] = shift_up(One);
+        PawnAttacks[Black][sq] = shift_down(One);
+        KnightAttacks[sq] = (One << 16) | (One >> 16) | (Two << 8) | (Two >> 8);
+        KingAttacks[sq] = (Row | shift_up(Row) | shift_down(Row)) & ~b;
+    }
+
+    init_magics(BishopMagics, BishopTable, BishopDirections, BishopMagicNumbers);
+    init_magics(RookMagics, RookTable, RookDirections, RookMagicNumbers);
+
+    // Линии и отрезки между клетками строятся пересечением атак дальнобойных фигур с обеих клеток
+    for (int a = 0; a < 64; a++)
+        for (int b = 0; b < 64; b++){
+            Between[a][b] = Line[a][b] = 0;
+
+            if (a != b && (bishop_attacks(a, 0) & square_bb(b))){
+                Line[a][b] = (bishop_attacks(a, 0) & bishop_attacks(b, 0)) | square_bb(a) | square_bb(b);
+                Between[a][b] = bishop_attacks(a, square_bb(b)) & bishop_attacks(b, square_bb(a));
+            }
+            if (a != b && (rook_attacks(a, 0) & square_bb(b))){
+                Line[a][b] = (rook_attacks(a, 0) & rook_attacks(b, 0)) | square_bb(a) | square_bb(b);
+                Between[a][b] = rook_attacks(a, square_bb(b)) & rook_attacks(b, square_bb(a));
+            }
+        }
+}
@@ -0,0 +1,93 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+// Перечисление возможных наименований фигур
+enum piece_name {Pawn, Knight, Bishop, Rook, Queen, King, NoName};
+// Перечисление цветов
+enum piece_colour {White, Black, NoColour};
+// Нумерация используется как индекс в массивах битбордов позиции
+
+const int Gridsize = 8; // Размер поля
+
+// Битборд - 64-битная маска, каждый бит которой соответствует одной клетке доски
+// Нумерация клеток: a1 = 0, b1 = 1, ... h1 = 7, a2 = 8, ... h8 = 63
+typedef uint64_t bitboard;
+
+const bitboard FileA = 0x0101010101010101ULL;
+const bitboard FileH = FileA << 7;
+const bitboard Rank1 = 0xFFULL;
+const bitboard Rank3 = Rank1 << 16;
+const bitboard Rank6 = Rank1 << 40;
+const bitboard Rank8 = Rank1 << 56;
+
+// Перевод координат в номер клетки и обратно
+inline int make_square (int hor, int vert) {return vert * Gridsize + hor;}
+inline int square_hor (int sq) {return sq & 7;}
+inline int square_vert (int sq) {return sq >> 3;}
+inline bitboard square_bb (int sq) {return bitboard(1) << sq;}
+
+const int NoSquare = 64; // Отсутствие клетки, например поля взятия на проходе
+
+inline piece_colour opposite (piece_colour c) {return piece_colour(c ^ 1);}
+
+// Количество фигур в маске и извлечение клеток по одной
+inline int pop_count (bitboard b) {return __builtin_popcountll(b);}
+inline int first_square (bitboard b) {return __builtin_ctzll(b);}
+inline int pop_first (bitboard& b) {int sq = first_square(b); b &= b - 1; return sq;}
+
+// Сдвиги маски на одну клетку с отсечением перехода через край доски
+inline bitboard shift_up (bitboard b) {return b << 8;}
+inline bitboard shift_down (bitboard b) {return b >> 8;}
+inline bitboard shift_left (bitboard b) {return (b & ~FileA) >> 1;}
+inline bitboard shift_right (bitboard b) {return (b & ~FileH) << 1;}
+
+// Таблицы клеток, атакуемых фигурой с каждой клетки доски
+extern bitboard PawnAttacks[2][64];
+extern bitboard KnightAttacks[64];
+extern bitboard KingAttacks[64];
+
+// "Магическая" таблица атак дальнобойной фигуры с одной клетки
+// Занятые клетки на лучах фигуры (Mask) умножением на Magic и сдвигом на Shift превращаются в номер
+// варианта атак в Attacks. При сборке с USE_PEXT номер вычисляется инструкцией PEXT, и Magic не нужен
+struct magic {
+    bitboard Mask;
+    bitboard Magic;
+    bitboard* Attacks;
+    int Shift;
+
+    unsigned index (bitboard occupied) const
+    {
+#ifdef USE_PEXT
+        return unsigned(_pext_u64(occupied, Mask));
+#else
+        return unsigned(((occupied & Mask) * Magic) >> Shift);
+#endif
+    }
+};
+
+extern magic BishopMagics[64];
+extern magic RookMagics[64];
+
+// Клетки строго между двумя клетками одной вертикали, горизонтали или диагонали (иначе пустая маска)
+extern bitboard Between[64][64];
+// Вся линия доски, проходящая через две клетки, включая их самих (иначе пустая маска)
+extern bitboard Line[64][64];
+
+// Заполнение таблиц атак, вызывается один раз при запуске программы
+void init_bitboards ();
+
+// Маски клеток, атакуемых фигурой с клетки sq
+inline bitboard pawn_attacks (piece_colour c, int sq) {return PawnAttacks[c][sq];}
+inline bitboard knight_attacks (int sq) {return KnightAttacks[sq];}
+inline bitboard king_attacks (int sq) {return KingAttacks[sq];}
+
+// Для дальнобойных фигур луч обрывается на первой занятой клетке из occupied
+inline bitboard bishop_attacks (int sq, bitboard occupied) {return BishopMagics[sq].Attacks[BishopMagics[sq].index(occupied)];}
+inline bitboard rook_attacks (int sq, bitboard occupied) {return RookMagics[sq].Attacks[RookMagics[sq].index(occupied)];}
+
+#endif
@@ -1,1364 +1,726 @@
 #include <iostream>
-#include <cmath>
+#include <iomanip>
+#include <cstdio>
 #include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include "Position.h"
+#include "Eval.h"
+#include "Movegen.h"
+#include "Notation.h"
+#include "Pgn.h"
+#include "Search.h"
+#include "Server.h"
+#include "Session.h"
+#include "Stats.h"
+#include "TT.h"
+#include "Uci.h"
 
 using namespace std;
 
-// Перечисление возможных наименований фигур
-enum piece_name {Pawn, Knight = 8, Bishop = 10, Rook = 12, Queen = 14, King = 15, NoName};
-// Перечисление цветов
-enum piece_colour {White, Black = 16, NoColour};
-// Нумерация введена для размещения адресов фигур в массиве Game.PiecePointer
+// Партия, которая идет в консоли
+game_session Game;
 
-const int Gridsize = 8; // Размер поля
+// Символы фигур для вывода доски, номер символа равен наименованию фигуры, 'o' - пустая клетка
+const char BoardSymbols[] = "pnbrQKo";
 
-// Начальная позиция, записанная в формате FEN
-char startFEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq";
-//char startFEN[] = "4k3/3R1R2/8/8/4P3/8/PPPP1PPP/1N1K1N1 b KQkq";
-
-// Шаги указателя по двумерному массиву клеток
-const int StepUp = 1;
-const int StepDown = -1;
-const int StepLeft = -Gridsize;
-const int StepRight = Gridsize;
-
-// Объединение для записи направления в случае шаха или блокировки
-union pinstep {int TwoBytes; char OneByte[2];};
-
-struct king_safety;
-struct info;
-
-// Класс - клетка
-class cell {
-    piece_name Name; // Наименование фигуры, занимающей клетку
-    piece_colour Colour; // Цвет фигуры, занимающей клетку
-    int Vertical_Coord; // Вертикальная координата
-    int Horizontal_Coord; // Горизонтальная координата
-    
-    void writesquare (char *PieceMoves, int mode); // Короткая функция записи координат в строку доступных ходов
-    
-    // Функция, записывающая все возможные ходы для фигуры на клетке в Game.CorrectMoves
-    void movement_list (); 
-    // Функции типа ..._moves вызываются из movement_list() и отвечают за возможные ходы одной фигуры с одной клетки
-    void bishop_moves (char *PieceMoves); // Функция проверки и записи ходов по диагоналям
-    void rook_moves (char *PieceMoves); // Функция проверки и записи ходов по горизонтали и вертикали
-    void king_moves (char *PieceMoves); // Функция проверки ходов короля
-    bool squarecheck (char *PieceMoves); // Функция проверки конкретной клетки
-    
-    // Функция, проверяющая клетку короля на предмет атаки вражескими фигурами
-    // При вызове без аргумента возвращает false при первом обнаружении угрозы
-    // При вызове с аргументом 1 также учитывает состояние шаха и блокированные фигуры и корректирует Game.CorrectMoves
-    bool check_king (int mode = 0);
-    
-    // Функции типа ..._threat вызываются из check_king() и отвечают за проверку клетки на нахождение на ней опасности
-    int king_threat (int mode); // Проверка вражеского короля
-    int rook_threat (int mode, int step, king_safety& SafetyInfo); // Проверка вражеской ладьи и ферзя
-    int bishop_threat (int mode, int step, king_safety& SafetyInfo); // Проверка вражеского слона и ферзя
-    int pawn_threat (int mode, int step, king_safety& SafetyInfo); // Проверка вражеской пешки
-    int knight_threat (int mode, king_safety& SafetyInfo); // Проверка вражеского коня
-    
-    
-  public:
-    void set_cell ( int hor, int vert, piece_name name, piece_colour colour); // Определение всех параметров клетки
-    void pointer_set (); // Запись адреса клетки с фигурой в массив Game.PiecePointer
-    
-    void operator=(cell& Initial); // Перегруженный оператор "=", используемый для осуществления хода
-    
-    char board_symbol(); // Вывод в консоль символа, соответствующего наименованию фигуры
-    
-    friend bool count_moves(); // Расчет доступных ходов и проверка конца игры
-    friend bool read_command(char* command); // Проверка правильности команды и совершение хода
-    
-    friend void check_castle(); // Проверка доступности рокировок
-    
-    friend void load_FEN (char* Position); // Загрузка партии по нотации FEN
-};
-
-// Структура, хранящая все необходимые данные, относящиеся к партии
-struct info {
-    piece_colour CurrentColour = White; // Цвет фигур игрока, делающего текущий ход
-    int TurnCount = 1; // Счетчик ходов (пока не использован)
-    char MoveLog[1000] = ""; // История ходов (пока не использован)
-    
-    // Строка, содержащая все доступные ходы
-    // Формат записи : ... /e4:e5e6 ..., где e4 -  исходная клетка; e5,e6 - доступные к перемещению клетки
-    char CorrectMoves[720] = ""; 
-    
-    bool GameOver = false; // Флаг окончания игры
-    
-    // Флаги доступности рокировок
-    bool WhiteLongCastleAvailable = false;
-    bool WhiteShortCastleAvailable = false;
-    bool BlackLongCastleAvailable = false;
-    bool BlackShortCastleAvailable = false;
-    
-    // Массив Адресов всех фигур, порядок соотетствует нумерации перечислений
-    cell *PiecePointer[32];
-    
-    // Конструктор, устанавливающий адреса фигур нулевыми
-    info () {for (int i = 0; i < 32; i++) PiecePointer[i] = 0;}
-};
-
-// Создание глобальной структуры Game и массива клеток Board 8x8
-info Game;
-cell Board[Gridsize][Gridsize];
-
-// Структура, хранящая все данные, необходимые при проверке безопасности короля
-struct king_safety {
-    int Attackers = 0;  //Количество фигур, дающих шах королю
-    cell* Ally = 0;     // Указатель на клетку-союзника, блокирующего шах
-    
-    // Строка, содержащая положение блокированных фигур
-    /* Формат записи : ... e6vhe2 ..., где e6 - клетка блокированной фигуры; h и v - (-1, 1) шаги по вертикали и горизонтали;
-    e2 - клетка атакующей фигуры */
-    char Pinned[55] = "";
-    
-    // Строка, содержащая положение фигуры, дающей шах королю
-    /* Формат записи : e6vhe1, где e6 - клетка атакующего; h и v - (-1, 1) шаги по вертикали и горизонтали;
-    e1 - клетка короля*/
-    char Threats[33] = "";
-};
-
-// Определение всех параметров клетки
-void cell :: set_cell (int hor, int vert, piece_name n = NoName, piece_colour c = NoColour)
-{
-    Name = n;
-    Colour = c;
-    Vertical_Coord = vert;
-    Horizontal_Coord = hor;
-}
-
-// Встраиваемая функция записи координат в строку доступных ходов
-inline void cell :: writesquare (char *PieceMoves, int mode = 0)
+// Вывод в консоль всей доски
+void show_board()
 {
-    char temp[3];
-    temp[0] = 'a' + char(Horizontal_Coord);
-    temp[1] = '1' + char(Vertical_Coord);
-    
-    if (mode == 0)
-        // Запись координат в строку, не содержащую нулевых символов, т.е. Game.CorrectMoves
-        strcat(PieceMoves, temp);
-    else{
-        // Запись координат в строку, содержащую нулевой символ, т.е. Pinned и Threats
-        for (; *PieceMoves || *(PieceMoves + 1); PieceMoves += 2);
-        *(PieceMoves++) = 'a' + char(Horizontal_Coord);
-        *PieceMoves = '1' + char(Vertical_Coord);
+    for (int v = 7; v >= 0; --v){
+        for (int h = 0; h < 8; ++h)
+            cout << BoardSymbols[Game.Pos.piece_on(make_square(h, v))] << ' ';
+        cout << '\n';
     }
 }
 
-// Встраиваемая функция, записывающая направление от исходной клетки к конечной
-// Используется для записи в Pinned и Threats
-// Записывает два char значения, при сложении с которыми получается на шаг приближенные к конечным координаты
-// Например 'e' + 0b0000 = 'e', '4' + 0b1111 = '3': "e4" -> "e3"
-inline void writestep (char* Pinned, int step)
+// Проверка конца игры, по окончании партии выводится сообщение и ее запись
+bool count_moves ()
 {
-    pinstep s;
-    
-    switch (step){
-        case StepUp:
-            s.TwoBytes = 1; break; // 0000 0001
-        case StepDown:
-            s.TwoBytes = 255; break; // 0000 1111
-        case StepLeft:
-            s.TwoBytes = -256; break; // 1111 0000
-        case StepRight:
-            s.TwoBytes = 256; break; // 0001 0000
-        case StepUp + StepRight:
-            s.TwoBytes = 257; break; // 0001 0001
-        case StepUp + StepLeft:
-            s.TwoBytes = -255; break; // 1111 0001
-        case StepDown + StepRight:
-            s.TwoBytes = 511; break; // 0001 1111
-        case StepDown + StepLeft:
-            s.TwoBytes = -1; break; // 1111 1111
-    }
+    const char* Message = 0;
     
-    for (; *(Pinned) || *(Pinned + 1); Pinned += 2); // Поиск конца в строке, возможно содержащей нулевой символ
+    switch (Game.State){
+        case GamePlaying:
+            return true;
+        case GameStalemate:
+            Message = "Пат, ничья, игра окончена";
+            break;
+        case GameCheckmate:
+            Message = "Шах и мат, игра окончена";
+            break;
+        case GameRule50:
+            Message = "Ничья по правилу 50 ходов, игра окончена";
+            break;
+        case GameRepetition:
+            Message = "Ничья троекратным повторением позиции, игра окончена";
+            break;
+        case GameNoMaterial:
+            Message = "Ничья, недостаточно материала для мата, игра окончена";
+            break;
+    }
     
-    *(Pinned++) = s.OneByte[1];
-    *Pinned = s.OneByte[0];
-
-    return;
+    cout << Message << "\n\n";
+    cout.flush();
+    write_PGN (stdout, Game.Record);
+    fflush(stdout);
+    return false;
 }
 
-// Встраиваемая функция, проверяющая цвет клетки. Используется при расчете всех возможных ходов
-inline bool cell :: squarecheck(char *PieceMoves)
-{
-    if (Colour == NoColour){
-        writesquare(PieceMoves);
-        return true;
+// Проверка введенной команды на правильность и совершение хода
+bool read_command (char* command)
+{   
+    // Отмена последнего хода
+    if (!strcmp(command, "back"))
+        return Game.take_back();
+    
+    // Вывод записи партии в формате PGN
+    if (!strcmp(command, "pgn")){
+        cout.flush();
+        write_PGN (stdout, Game.Record);
+        fflush(stdout);
+        return false;
     }
     
-    if (Colour == Game.CurrentColour)
-        return false;
+    // Ход вводится координатами ("e2e4", "e7e8q") или в алгебраической нотации ("Nf3", "exd5", "O-O")
+    chess_move m = Game.parse_move (command);
     
-    if (Colour != Game.CurrentColour)
-        writesquare(PieceMoves);
+    if (m != NoMove){
+        Game.play (m);
+        return true;
+    }
     
+    cout << '\n' << "Неправильный ход" << '\n';
     return false;
 }
 
-// Запись всех возможных ходов по диагоналям из исходной клетки
-void cell :: bishop_moves (char *PieceMoves)
+// Режим perft: подсчет позиций на заданную глубину с выводом числа позиций после каждого хода
+bool run_perft (int depth, const char* FEN)
 {
-    cell *TargetSquare = 0;
-    int step;
-    
-    if (Vertical_Coord < 7 && Horizontal_Coord > 0){
-        TargetSquare = this + StepUp + StepLeft;
-        for (step = StepUp + StepLeft; ; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 7 || TargetSquare -> Horizontal_Coord == 0)
-                break;
-        }
-    }
-            
-    if (Vertical_Coord < 7 && Horizontal_Coord < 7){
-        TargetSquare = this + StepUp + StepRight;
-        for (step = StepUp + StepRight; ; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 7 || TargetSquare -> Horizontal_Coord == 7)
-                break;
-        }
-    }
-            
-    if (Vertical_Coord > 0 && Horizontal_Coord > 0){
-        TargetSquare = this + StepDown + StepRight;
-        for (step = StepDown + StepRight; ; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 0 || TargetSquare -> Horizontal_Coord == 7)
-                break;
-        }
+    position Pos;
+    move_list List;
+    undo Undo;
+    uint64_t Nodes, Total = 0;
+    char str[6];
+    
+    if (!load_FEN (Pos, FEN)){
+        cout << "Неправильная позиция FEN: " << FEN << '\n';
+        return false;
     }
-            
-    if (Vertical_Coord > 0 && Horizontal_Coord < 7){
-        TargetSquare = this + StepDown + StepLeft;
-        for (step = StepDown + StepLeft; ; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 0 || TargetSquare -> Horizontal_Coord == 0)
-                break;
-        }
+    generate_moves (Pos, List);
+    
+    auto Start = chrono::steady_clock::now();
+    
+    for (int i = 0; i < List.Count; i++){
+        make_move (Pos, List.Moves[i], Undo);
+        Nodes = perft (Pos, depth - 1);
+        unmake_move (Pos, List.Moves[i], Undo);
+        Total += Nodes;
+        
+        move_to_string (List.Moves[i], str);
+        cout << str << ": " << Nodes << '\n';
     }
+    
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    
+    cout << '\n' << "Позиций: " << Total << '\n';
+    cout << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    cout << "Позиций в секунду: " << uint64_t(Seconds > 0 ? Total / Seconds : 0) << '\n';
+    return true;
 }
 
-// Запись всех возможных ходов по вертикали и горизонтали из исходной клетки
-void cell :: rook_moves (char *PieceMoves)
+// Потоковый режим: обработка файла с позициями FEN, по одной в строке
+// Все позиции загружаются в одну и ту же структуру без выделения памяти. При depth > 0 для каждой позиции
+// выполняется perft, иначе позиция только разбирается и записывается обратно в FEN
+bool run_fens (const char* FileName, int depth)
 {
-    cell *TargetSquare = 0;
-    cell *SquareZero = &Board[0][0];
-    cell *SquareEnd = &Board[7][7];
-    int step;
-    
-    TargetSquare = this + StepLeft;
-    for (step = StepLeft; TargetSquare >= SquareZero; TargetSquare += step){
-        if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
+    FILE* File = fopen(FileName, "r");
+    position Pos;
+    char Line[512];
+    char FEN[FENSize];
+    uint64_t Positions = 0, Invalid = 0, Nodes = 0;
+    int LineNumber = 0;
+    
+    if (!File){
+        cout << "Не удалось открыть файл " << FileName << '\n';
+        return false;
     }
     
-    TargetSquare = this + StepRight;
-    for (step = StepRight; TargetSquare <= SquareEnd; TargetSquare += step){
-        if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-    }
+    auto Start = chrono::steady_clock::now();
     
-    if (Vertical_Coord < 7){
-        TargetSquare = this + StepUp;
-        for (step = StepUp; TargetSquare <= SquareEnd; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 7)
-                break;
+    while (fgets(Line, sizeof(Line), File)){
+        LineNumber++;
+        
+        // Пустые строки и комментарии пропускаются
+        if (Line[0] == '\n' || Line[0] == '\r' || Line[0] == '#')
+            continue;
+        
+        if (!load_FEN (Pos, Line)){
+            Invalid++;
+            cout << "Строка " << LineNumber << ": неправильная позиция FEN" << '\n';
+            continue;
         }
+        
+        Positions++;
+        if (depth > 0)
+            Nodes += perft (Pos, depth);
+        else
+            to_FEN (Pos, FEN);
     }
+    fclose(File);
     
-    if (Vertical_Coord > 0){
-        TargetSquare = this + StepDown;
-        for (step = StepDown; (TargetSquare -> Vertical_Coord) >= 0 && TargetSquare >= SquareZero; TargetSquare += step){
-            if (TargetSquare -> squarecheck (PieceMoves) == false)
-                break;
-            if (TargetSquare -> Vertical_Coord == 7)
-                break;
-        }
-    }
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    
+    cout << "Позиций в файле: " << Positions << ", неправильных: " << Invalid << '\n';
+    if (depth > 0)
+        cout << "Позиций perft: " << Nodes << '\n';
+    cout << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    cout << "Позиций из файла в секунду: " << uint64_t(Seconds > 0 ? Positions / Seconds : 0) << '\n';
+    return true;
 }
 
-// Запись всех возможных ходов короля из исходной клетки
-void cell :: king_moves (char *PieceMoves)
+// Упаковка файла позиций FEN в двоичный файл из записей по 32 байта
+bool run_pack (const char* InName, const char* OutName)
 {
-    cell *TargetSquare = 0;
-    cell *SquareZero = &Board[0][0];
-    cell *SquareEnd = &Board[7][7];
-    
-    // При проверке ходов короля на каждом шаге проверяется безопасность короля
-    // Во избежание "защиты" короля им самим, на время проверки его клетка обнуляется
-    Colour = NoColour;
-    Name = NoName;
-    
-    if (Horizontal_Coord > 0){
-        TargetSquare = this + StepLeft;
-        
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
-    }
-    
-    if (Horizontal_Coord < 7){
-        TargetSquare = this + StepRight;
-        
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
+    FILE* In = fopen(InName, "r");
+    FILE* Out = In ? fopen(OutName, "wb") : 0;
+    position Pos;
+    packed_position Packed;
+    char Line[512];
+    uint64_t Positions = 0, Invalid = 0;
+    int LineNumber = 0;
+    
+    if (!In || !Out){
+        cout << "Не удалось открыть файл " << (In ? OutName : InName) << '\n';
+        if (In)
+            fclose(In);
+        return false;
     }
     
-    if (Vertical_Coord < 7){
-        TargetSquare = this + StepUp;
-        
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
-    }
+    auto Start = chrono::steady_clock::now();
     
-    if (Vertical_Coord > 0){
-        TargetSquare = this + StepDown;
+    while (fgets(Line, sizeof(Line), In)){
+        LineNumber++;
         
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
-    }
-    
-    if (Vertical_Coord > 0 && Horizontal_Coord > 0){
-        TargetSquare = this + StepDown + StepLeft;
+        if (Line[0] == '\n' || Line[0] == '\r' || Line[0] == '#')
+            continue;
         
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
-    }
-    
-    if (Vertical_Coord > 0 && Horizontal_Coord < 7){
-        TargetSquare = this + StepDown + StepRight;
+        if (!load_FEN (Pos, Line)){
+            Invalid++;
+            cout << "Строка " << LineNumber << ": неправильная позиция FEN" << '\n';
+            continue;
+        }
         
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
+        if (!pack_position (Pos, Packed)){
+            Invalid++;
+            cout << "Строка " << LineNumber << ": позиция не помещается в упакованную запись" << '\n';
+            continue;
+        }
+        fwrite(&Packed, sizeof(Packed), 1, Out);
+        Positions++;
     }
+    fclose(In);
     
-    if (Vertical_Coord < 7 && Horizontal_Coord > 0){
-        TargetSquare = this + StepUp + StepLeft;
-        
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
+    bool Written = !ferror(Out);
+    if (fclose(Out) != 0 || !Written){
+        cout << "Ошибка записи в файл " << OutName << '\n';
+        return false;
     }
     
-    if (Vertical_Coord < 7 && Horizontal_Coord < 7){
-        TargetSquare = this + StepUp + StepRight;
-        
-        if (TargetSquare -> Colour != Game.CurrentColour)
-            if (TargetSquare -> check_king())
-                TargetSquare -> writesquare(PieceMoves);
-    }
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
     
-    // "Возврат" короля на доску
-    Colour = Game.CurrentColour;
-    Name = King;
+    cout << "Упаковано позиций: " << Positions << ", неправильных: " << Invalid << ", байт: " << Positions * sizeof(Packed) << '\n';
+    cout << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    cout << "Позиций в секунду: " << uint64_t(Seconds > 0 ? Positions / Seconds : 0) << '\n';
+    return true;
 }
 
-// Проверка доступности рокировок и запись соответствующих команд в Game.CorrectMoves
-void check_castle ()
+// Распаковка двоичного файла позиций обратно в FEN, по одной позиции в строке
+bool run_unpack (const char* InName, const char* OutName)
 {
-    if (Game.CurrentColour == White && Game.WhiteShortCastleAvailable){
-        if (Board[5][0].Name == NoName && Board[6][0].Name == NoName)
-            if (Board[5][0].check_king() && Board[6][0].check_king())
-                strcat(Game.CorrectMoves, "/O-O");
-    }
-    if (Game.CurrentColour == White && Game.WhiteLongCastleAvailable){
-        if (Board[3][0].Name == NoName && Board[2][0].Name == NoName)
-            if (Board[3][0].check_king() && Board[2][0].check_king())
-                strcat(Game.CorrectMoves, "/O-O-O");
+    FILE* In = fopen(InName, "rb");
+    FILE* Out = In ? fopen(OutName, "w") : 0;
+    position Pos;
+    packed_position Packed;
+    char FEN[FENSize];
+    uint64_t Positions = 0, Invalid = 0;
+    
+    if (!In || !Out){
+        cout << "Не удалось открыть файл " << (In ? OutName : InName) << '\n';
+        if (In)
+            fclose(In);
+        return false;
     }
     
-    if (Game.CurrentColour == Black && Game.BlackShortCastleAvailable){
-        if (Board[5][7].Name == NoName && Board[6][7].Name == NoName)
-            if (Board[5][7].check_king() && Board[6][7].check_king())
-                strcat(Game.CorrectMoves, "/O-O");
-    }
-    if (Game.CurrentColour == Black && Game.BlackLongCastleAvailable){
-        if (Board[3][7].Name == NoName && Board[2][7].Name == NoName)
-            if (Board[3][7].check_king() && Board[2][7].check_king())
-                strcat(Game.CorrectMoves, "/O-O-O");
-    }
-}
-
-// Вычисление и запись всех доступных ходов с клетки
-void cell :: movement_list ()
-{
-    char Headline[5] = "";
-    char PieceMoves[43] = "";
-    cell *TargetSquare = this;
-    cell *SquareZero = &Board[0][0];
-    cell *SquareEnd = &Board[7][7];
-    int step;
-    
-    // Заголовок формата "/е4:"
-    Headline[0] = '/';
-    writesquare(Headline);
-    Headline[3] = ':';
-    
-    switch (Name){
-        case Pawn:
-            if (Colour == White)
-                step = StepUp;
-            else
-                step = StepDown;
-            
-            TargetSquare = this + step;
-            if (TargetSquare -> Colour == NoColour){
-                TargetSquare -> writesquare(PieceMoves);
-                
-                TargetSquare += step;
-                if (Vertical_Coord == 1 && Colour == White && TargetSquare -> Colour == NoColour)
-                    TargetSquare -> writesquare(PieceMoves);
-                
-                if (Vertical_Coord == 6 && Colour == Black && TargetSquare -> Colour == NoColour)
-                    TargetSquare -> writesquare(PieceMoves);
-            }
-            
-            if (Horizontal_Coord != 0){
-                if (Colour == White)
-                    step = StepUp + StepLeft;
-                else
-                    step = StepDown + StepLeft;
-                
-                TargetSquare = this + step;
-                if (TargetSquare -> Colour != Colour && TargetSquare -> Colour != NoColour)
-                    TargetSquare -> writesquare(PieceMoves);
-            }
-            
-            if (Horizontal_Coord != 7){
-                if (Colour == White && Horizontal_Coord < 0)
-                    step = StepUp + StepRight;
-                else
-                    step = StepDown + StepRight;
-                
-                TargetSquare = this + step;
-                if (TargetSquare -> Colour != Colour && TargetSquare -> Colour != NoColour)
-                    TargetSquare -> writesquare(PieceMoves);
-            }
-        break;
-        
-        case Knight:
-            if (Vertical_Coord > 0 && Horizontal_Coord > 1){ TargetSquare = this + 2*StepLeft + StepDown;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves); }
-            
-            if (Vertical_Coord > 0 && Horizontal_Coord < 6){ TargetSquare = this + 2*StepRight + StepDown;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord < 7 && Horizontal_Coord > 1){ TargetSquare = this + 2*StepLeft + StepUp;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord < 7 && Horizontal_Coord < 6){ TargetSquare = this + 2*StepRight + StepUp;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord > 1 && Horizontal_Coord > 0){ TargetSquare = this + StepLeft + 2*StepDown;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord > 1 && Horizontal_Coord < 7){ TargetSquare = this + StepRight + 2*StepDown;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord < 6 && Horizontal_Coord > 0){ TargetSquare = this + StepLeft + 2*StepUp;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-            
-            if (Vertical_Coord < 6 && Horizontal_Coord < 7){ TargetSquare = this + StepRight + 2*StepUp;
-                if (TargetSquare -> Colour != Colour) TargetSquare -> writesquare(PieceMoves);}
-        break;
-        
-        case Bishop:
-            bishop_moves(PieceMoves);
-            break;
-        
-        case Rook:
-            rook_moves(PieceMoves);
-            break;
-        
-        case Queen:
-            bishop_moves(PieceMoves);
-            rook_moves(PieceMoves);
-            break;
+    auto Start = chrono::steady_clock::now();
+    
+    while (fread(&Packed, sizeof(Packed), 1, In) == 1){
+        if (!unpack_position (Pos, Packed)){
+            Invalid++;
+            cout << "Запись " << Positions + Invalid << ": неправильная позиция" << '\n';
+            continue;
+        }
         
-        case King:
-            king_moves(PieceMoves);
-            break;
+        to_FEN (Pos, FEN);
+        fputs(FEN, Out);
+        fputc('\n', Out);
+        Positions++;
     }
     
-    //cout << Headline << PieceMoves << '\n';
+    bool Truncated = !feof(In) || ftell(In) % sizeof(Packed) != 0;
+    fclose(In);
     
-    // Внесение заголовка в Game.CorrectMoves происходит только при наличии доступных ходов
-    if (strcmp(PieceMoves, "")){
-        strcat(Game.CorrectMoves, Headline);
-        strcat(Game.CorrectMoves, PieceMoves);
+    bool Written = !ferror(Out);
+    if (fclose(Out) != 0 || !Written){
+        cout << "Ошибка записи в файл " << OutName << '\n';
+        return false;
     }
+    if (Truncated)
+        cout << "Файл " << InName << " обрывается посреди записи" << '\n';
+    
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    
+    cout << "Распаковано позиций: " << Positions << ", неправильных: " << Invalid << '\n';
+    cout << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    cout << "Позиций в секунду: " << uint64_t(Seconds > 0 ? Positions / Seconds : 0) << '\n';
+    return !Truncated;
 }
 
-// Перегруженный оператор "=", используемый для осуществления хода
-void cell :: operator=(cell& Initial)
+// Чтение базы партий PGN: все ходы каждой партии проверяются и выполняются на доске
+bool run_pgn (const char* FileName)
 {
-    // Левая граница индекса фигуры в массиве Game.PiecePointer
-    // Например: черный слон ищется в массиве начиная с индекса 16 + 10 = 26
-    int i = (int) Game.CurrentColour + (int) Initial.Name; 
+    FILE* File = fopen(FileName, "r");
+    pgn_game Record;
+    uint64_t Games = 0, Invalid = 0, Plies = 0;
     
-    int count; // Количество фигур с таким же именем в массиве Game.PiecePointer
-    
-    switch(Initial.Name){
-        case Pawn: count = 8; break;
-        case King: count = 1; break;
-        case Queen: count = 1; break;
-        default: count = 2; break;
+    if (!File){
+        cout << "Не удалось открыть файл " << FileName << '\n';
+        return false;
     }
     
-    // Замена адреса клетки, на которой стояла фигура, адресом клетки, на которую она передвинулась
-    for(; count > 0; count--, i++)
-        if (Game.PiecePointer[i] == &Initial)
-            Game.PiecePointer[i] = this;
-    
-    // Если фигура забирает вражескую, адрес, соответствующий вражеской фигуре, в Game.PiecePointer зануляется
-    if (Name != NoName){
-        i = (int) Colour + (int) Name;
-        switch(Name){
-            case Pawn: count = 8; break;
-            case King: count = 1; break;
-            case Queen: count = 1; break;
-            default: count = 2; break;
-        } // Аналогичный поиск вражеской фигуры в массиве адресов
-    
-        for(; count > 0; count--, i++)
-            if (Game.PiecePointer[i] == this)
-                Game.PiecePointer[i] = 0;
-    }
+    pgn_reader Reader(File);
+    auto Start = chrono::steady_clock::now();
     
-    Name = Initial.Name;
-    Colour = Initial.Colour; // На конечной клетке в итоге оказывается фигура с начальной
+    while (Reader.read_game (Record)){
+        Games++;
+        Plies += Record.Moves.size();
+        
+        if (Record.ErrorLine){
+            Invalid++;
+            cout << "Партия " << Games << ", строка " << Record.ErrorLine << ": неправильный ход или позиция" << '\n';
+        }
+    }
+    fclose(File);
     
-    Initial.Name = NoName;
-    Initial.Colour = NoColour; // Начальная клетка в итоге окаызывается свободна
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
     
+    cout << "Партий: " << Games << ", с ошибками: " << Invalid << '\n';
+    cout << "Ходов: " << Plies << '\n';
+    cout << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    cout << "Партий в секунду: " << uint64_t(Seconds > 0 ? Games / Seconds : 0)
+         << ", ходов в секунду: " << uint64_t(Seconds > 0 ? Plies / Seconds : 0) << '\n';
+    return true;
 }
 
-// Вывод в консоль символа, соответствующего наименованию фигуры
-char cell :: board_symbol()
-{
-    switch (Name){
-        case NoName: return 'o';
-        case Pawn: return 'p';
-        case Knight: return 'n';
-        case Bishop: return 'b';
-        case Rook: return 'r';
-        case Queen: return 'Q';
-        case King: return 'K';
-    }
-    return 'o';
-}
-
-// Запись адреса клетки с фигурой в массив Game.PiecePointer
-inline void cell :: pointer_set ()
+// Вывод результатов итерации поиска
+void print_report (const search_report& Report)
 {
-    int count = (int) Colour + (int) Name;
-    while (Game.PiecePointer[count])
-        count++;
-    Game.PiecePointer[count] = this;
+    char str[6];
+    
+    move_to_string (Report.BestMove, str);
+    cout << "Глубина " << Report.Depth << "  оценка " << Report.Score << "  позиций " << Report.Nodes
+         << "  позиций в секунду " << Report.Nodes * 1000 / (Report.Time > 0 ? Report.Time : 1)
+         << "  время " << Report.Time << " мс  ход " << str << '\n';
+    cout << "    хеш: попаданий " << (Report.HashProbes ? Report.HashHits * 100 / Report.HashProbes : 0)
+         << "%  заполнено " << Report.HashFull / 10 << "% из " << TT.size_MB() << " МБ"
+         << "  пешечный хеш: попаданий " << (Report.PawnProbes ? Report.PawnHits * 100 / Report.PawnProbes : 0) << "%" << '\n';
 }
 
-// Загрузка позиции в нотации FEN
-void load_FEN (char* sym)
+// Режим анализа: поиск лучшего хода в позиции за заданное время
+bool run_search (int MoveTime, int Threads, const char* FEN)
 {
-    cell* const StartSquare = &Board[0][7]; // Расположение фигур считывается начиная с клетки а8
-    cell* Square = StartSquare;
-    int spaces, rowcount;
+    position Pos;
+    search_limits Limits;
+    char str[6];
     
-    // Считывание положения фигур
-    for (rowcount = 1; rowcount < 9; ++sym){
-        
-        // Обнаружение цифры и пропуск пробелов
-        if (*sym > '0' && *sym < '9'){
-            spaces = *sym - '0';
-            for (; spaces > 0; spaces--, Square += StepRight);
-        }
-        else{
-            switch (*sym){
-                case 'R': Square -> Name = Rook; Square -> Colour = White; break;
-                case 'N': Square -> Name = Knight; Square -> Colour = White; break;
-                case 'B': Square -> Name = Bishop; Square -> Colour = White; break;
-                case 'Q': Square -> Name = Queen; Square -> Colour = White; break;
-                case 'K': Square -> Name = King; Square -> Colour = White; break;
-                case 'P': Square -> Name = Pawn; Square -> Colour = White; break;
-                
-                case 'r': Square -> Name = Rook; Square -> Colour = Black; break;
-                case 'n': Square -> Name = Knight; Square -> Colour = Black; break;
-                case 'b': Square -> Name = Bishop; Square -> Colour = Black; break;
-                case 'q': Square -> Name = Queen; Square -> Colour = Black; break;
-                case 'k': Square -> Name = King; Square -> Colour = Black; break;
-                case 'p': Square -> Name = Pawn; Square -> Colour = Black; break;
-            }
-            if (*sym == '/' || *sym == ' '){
-                Square = StartSquare - rowcount; // Переход на следующий ряд
-                rowcount++;
-                continue;
-            }
-            else{
-                Square -> pointer_set();
-                
-                if (Square -> Horizontal_Coord < 7)
-                    Square += StepRight;
-            }
-        }
+    if (!load_FEN (Pos, FEN)){
+        cout << "Неправильная позиция FEN: " << FEN << '\n';
+        return false;
     }
+    Limits.MoveTime = MoveTime;
+    Limits.Threads = Threads;
     
-    // Считывание активного цвета
-    if (*(sym) == 'w')
-        Game.CurrentColour = White;
-    if (*(sym ) == 'b')
-        Game.CurrentColour = Black;
-    
-    sym += 2;
-    
-    // Считывание доступных рокировок
-    for (; *sym; sym++){
-        switch (*sym){
-            case 'K': Game.WhiteShortCastleAvailable = true; break;
-            case 'Q': Game.WhiteLongCastleAvailable = true; break;
-            case 'k': Game.BlackShortCastleAvailable = true; break;
-            case 'q': Game.BlackLongCastleAvailable = true; break;
-        }
-    }
-}
-
-// Вывод в консоль всей доски
-void show_board()
-{
-    int v, h;
+    search_report Result = think (Pos, Limits, print_report);
     
-    for (v = 7; v >= 0; --v){
-        for (h = 0; h < 8; ++h)
-            cout << Board[h][v].board_symbol() << ' ';
-        cout << '\n';
+    if (Result.BestMove == NoMove){
+        cout << "Нет доступных ходов" << '\n';
+        return true;
     }
+    
+    move_to_string (Result.BestMove, str);
+    cout << "Лучший ход: " << str << '\n';
+    return true;
 }
 
-// Инициализация доски - назначение всем клеткам их координат
-void init_board()
+// Разбор строки EPD: первые четыре поля - позиция FEN без счетчиков ходов, за ними следуют операции
+// вида "bm Qg6; id "WAC.001";". Поля позиции копируются в FEN, возвращается указатель на начало операций
+const char* split_EPD (const char* Line, char* FEN, int size)
 {
-    int i, j;
-
-    for (j = 0; j < 8; ++j)
-        for (i = 0; i < 8; ++i)
-            Board[i][j].set_cell(i, j);
+    int Length = 0;
+    
+    for (int Field = 0; Field < 4; Field++){
+        for (; *Line == ' ' || *Line == '\t'; Line++);
+        if (Field > 0 && Length < size - 1)
+            FEN[Length++] = ' ';
+        for (; *Line && *Line != ' ' && *Line != '\t' && *Line != '\n' && *Line != '\r'; Line++)
+            if (Length < size - 1)
+                FEN[Length++] = *Line;
+    }
+    FEN[Length] = '\0';
+    return Line;
 }
 
-// Осуществление рокировок в короткую сторону
-void short_castle()
+// Поиск операции EPD с кодом Code. Возвращает указатель на ее операнды или 0, если операции нет
+const char* find_operation (const char* Ops, const char* Code)
 {
-    if (Game.CurrentColour == White){
-        Board[6][0] = Board[4][0];
-        Board[5][0] = Board[7][0];
-        Game.WhiteShortCastleAvailable = false;
-        Game.WhiteLongCastleAvailable = false;
-        return;
-    }
+    int CodeLength = strlen(Code);
     
-    if (Game.CurrentColour == Black){
-        Board[6][7] = Board[4][7];
-        Board[5][7] = Board[7][7];
-        Game.BlackShortCastleAvailable = false;
-        Game.BlackLongCastleAvailable = false;
-        return;
+    while (*Ops){
+        for (; *Ops == ' ' || *Ops == '\t'; Ops++);
+        if (!strncmp(Ops, Code, CodeLength) && Ops[CodeLength] == ' ')
+            return Ops + CodeLength + 1;
+        
+        // Переход к следующей операции, точка с запятой внутри кавычек операцию не завершает
+        bool Quoted = false;
+        for (; *Ops && (Quoted || *Ops != ';'); Ops++)
+            if (*Ops == '"')
+                Quoted = !Quoted;
+        if (*Ops)
+            Ops++;
     }
+    return 0;
 }
 
-// Осуществление рокировок в длинную сторону
-void long_castle()
+// Проверка, входит ли ход в список ходов операции "bm" или "am", записанных в SAN
+bool operation_has_move (const position& Pos, const char* Operands, chess_move m)
 {
-    if (Game.CurrentColour == White){
-        Board[2][0] = Board[4][0];
-        Board[3][0] = Board[0][0];
-        Game.WhiteShortCastleAvailable = false;
-        Game.WhiteLongCastleAvailable = false;
-        return;
-    }
+    char SAN[SANSize];
     
-    if (Game.CurrentColour == Black){
-        Board[2][7] = Board[4][7];
-        Board[3][7] = Board[0][7];
-        Game.BlackShortCastleAvailable = false;
-        Game.BlackLongCastleAvailable = false;
-        return;
+    while (*Operands && *Operands != ';' && *Operands != '\n' && *Operands != '\r'){
+        int Length = 0;
+        
+        for (; *Operands == ' '; Operands++);
+        for (; *Operands && !strchr(" ;\r\n", *Operands); Operands++)
+            if (Length < SANSize - 1)
+                SAN[Length++] = *Operands;
+        SAN[Length] = '\0';
+        
+        if (Length && SAN_to_move(Pos, SAN) == m)
+            return true;
     }
+    return false;
 }
 
-// Функция, заменяющая массив Game.CorrectMoves на аналогичный, но только с ходами, нейтрализующими шах королю
-void threat_block (char* Threats)
+// Копирование операнда операции (например, "id") без кавычек
+void copy_operand (const char* Operands, char* str, int size)
 {
-    char NewCorrectMoves[720] = "";
-    char Headline[5] = "/  :";
-    char PieceMoves[15] = "";
-    char TargetSquare[3] = "";
-    char* HeadPointer = Game.CorrectMoves;
-    char* TargetPointer;
-    char* end;
-    
-    // Поиск конца
-    for (end = Game.CorrectMoves; *end; ++end);
-    
-    while (HeadPointer < end){
-        for (; *HeadPointer != '/'; ++HeadPointer); // Поиск исходной клетки, например "/e4:"
-        
-        Headline[1] = *(HeadPointer + 1);
-        Headline[2] = *(HeadPointer + 2);
-        HeadPointer += 4;
-        
-        TargetSquare[0] = Threats[0];
-        TargetSquare[1] = Threats[1];
-        
-        while (TargetSquare[0] != Threats[4] || TargetSquare[1] != Threats[5]){
-        /* В цикле проверяют наличие поочередно всех клеток между королем и атакующим включительно, совпадения
-        записываются в PieceMoves.*/
-            
-            for (TargetPointer = HeadPointer; *TargetPointer != '/' && TargetPointer <= end; TargetPointer += 2){
-                if (*TargetPointer == TargetSquare[0] && *(TargetPointer + 1) == TargetSquare[1])
-                    strcat(PieceMoves, TargetSquare);
-            }
-            
-            if (Threats[2] == 'K' && Threats[3] == 'n')
-                break;
-            
-            if (Threats[2] == 'P' && Threats[3] == 'w')
-                break;
-            
-            TargetSquare[0] += Threats[2];
-            TargetSquare[1] += Threats[3];
-        }
-        
-        // Если найдено хоть одно совпадение, в NewCorrectMoves записывается заголовок и все совпадения
-        if (strcmp(PieceMoves, "")){
-            strcat(NewCorrectMoves, Headline);
-            strcat(NewCorrectMoves, PieceMoves);
-        }
-        
-        HeadPointer = TargetPointer; // Переход к следующему заголовку
-        for (char* p = PieceMoves; *p; p++) *p = '\0'; // Очистка PieceMoves
-    }
-    
-    strcpy (Game.CorrectMoves, NewCorrectMoves);
+    int Length = 0;
+    
+    if (Operands && *Operands == '"')
+        for (Operands++; *Operands && *Operands != '"' && Length < size - 1; Operands++)
+            str[Length++] = *Operands;
+    else if (Operands)
+        for (; *Operands && !strchr(";\r\n", *Operands) && Length < size - 1; Operands++)
+            str[Length++] = *Operands;
+    str[Length] = '\0';
 }
 
-// Функция, исключающая из Game.CorrectMoves все ходы заблокированной фигуры, кроме ходов навстречу атакующему
-void pinned_exclude (char* Pinned)
+// Пакетный режим: прогон набора тестовых позиций EPD
+// Для каждой позиции выполняется поиск с ограничениями Limits, позиция решена, если найденный ход
+// входит в список лучших ходов "bm" и не входит в список ошибочных ходов "am"
+bool run_epd (const char* FileName, const search_limits& Limits)
 {
-    char TargetSquare[3];
-    char *leftcount, *rightcount;
-    
-    // Поиск координат заблокированной фигуры
-    for (leftcount = Game.CorrectMoves; *(leftcount + 1); ++leftcount){
-        if (*leftcount == '/'){
-            if (*(leftcount + 1) == Pinned[0] && *(leftcount + 2) == Pinned[1]){
-                leftcount += 4;
-                rightcount = leftcount;
-                goto initalfound;
-            }
-            else
-                leftcount += 3;
-        }
+    FILE* File = fopen(FileName, "r");
+    position Pos;
+    char Line[1024];
+    char FEN[256];
+    char Id[64];
+    char SAN[SANSize];
+    int Total = 0, Solved = 0, LineNumber = 0;
+    uint64_t Nodes = 0;
+    uint64_t Time = 0;
+    
+    if (!File){
+        cout << "Не удалось открыть файл " << FileName << '\n';
+        return false;
     }
-    return;
-
-initalfound:
     
-    TargetSquare[0] = Pinned[0];
-    TargetSquare[1] = Pinned[1];
-    while (TargetSquare[0] != Pinned[4] || TargetSquare[1] != Pinned[5]){
+    while (fgets(Line, sizeof(Line), File)){
+        LineNumber++;
         
-        TargetSquare[0] += Pinned[2];
-        TargetSquare[1] += Pinned[3];
+        if (Line[0] == '\n' || Line[0] == '\r' || Line[0] == '#')
+            continue;
         
-        // Цикл проходит все доступные ходы фигуры и сравнивает их с клетками по направлению к атакующему
-        for (; *rightcount != '/' && *rightcount != '\0'; rightcount += 2){
-            if (*rightcount == TargetSquare[0] && *(rightcount + 1) == TargetSquare[1]){
-                *leftcount = *rightcount;
-                *(leftcount + 1) = *(rightcount + 1); // При совпадении происходит запись хода и дальнейший поиск
-                leftcount += 2;
-                rightcount += 2;
-                break;
-            }
+        const char* Ops = split_EPD(Line, FEN, sizeof(FEN));
+        if (!load_FEN (Pos, FEN)){
+            cout << "Строка " << LineNumber << ": неправильная позиция" << '\n';
+            continue;
         }
         
-        /* Достижение циклом конца доступных ходов означает, что в нужном направлении ходов больше нет,
-        остаток строки сдвигается влево к последнему ходу блокированной фигуры */ 
-        if (*rightcount == '/' || *rightcount == '\0'){
-            for (; *leftcount; leftcount++, rightcount++)
-                *leftcount = *rightcount;
-            
-            return;
-        }
+        const char* Best = find_operation(Ops, "bm");
+        const char* Avoid = find_operation(Ops, "am");
+        
+        copy_operand (find_operation(Ops, "id"), Id, sizeof(Id));
+        if (!Id[0])
+            snprintf(Id, sizeof(Id), "%d", LineNumber);
+        
+        // Результаты предыдущих позиций не должны влиять на поиск
+        TT.clear();
+        search_report Result = think (Pos, Limits);
+        
+        Total++;
+        Nodes += Result.Nodes;
+        Time += Result.Time;
+        
+        bool Ok = Result.BestMove != NoMove && (Best || Avoid)
+               && (!Best || operation_has_move(Pos, Best, Result.BestMove))
+               && (!Avoid || !operation_has_move(Pos, Avoid, Result.BestMove));
+        if (Ok)
+            Solved++;
+        
+        if (Result.BestMove != NoMove)
+            move_to_SAN (Pos, Result.BestMove, SAN);
+        else
+            strcpy(SAN, "-");
+        
+        cout << Id << ": " << SAN << (Ok ? "  решено" : "  не решено") << "  глубина " << Result.Depth
+             << "  позиций " << Result.Nodes << "  время " << Result.Time << " мс" << '\n';
     }
+    fclose(File);
     
+    cout << '\n' << "Решено: " << Solved << " из " << Total << '\n';
+    cout << "Позиций: " << Nodes << '\n';
+    cout << "Время: " << Time << " мс" << '\n';
+    cout << "Позиций в секунду: " << Nodes * 1000 / (Time > 0 ? Time : 1) << '\n';
+    return true;
 }
 
-// Проверка, атакована ли клетка вражеским королем
-inline int cell :: king_threat (int mode)
-{
-    if (Colour != Game.CurrentColour && Name == King)
-        return mode;
-    return 2;
-}
-
-// Проверка, атакована ли клетка вражеской ладьей или ферзем, закрытие от шаха и корректировка блокированных фигур
-// Функция вызывается из цикла внутри check_king() и возвращает 0, 1 или 2.
-int cell :: rook_threat (int mode, int step, king_safety& SafetyInfo)
+// Сборка позиции FEN из аргументов командной строки, начиная с first
+// Позволяет передавать FEN как одной строкой в кавычках, так и отдельными словами
+const char* join_args (int argc, char* argv[], int first, char* buffer, int size)
 {
-    if (Colour == NoColour) // Клетка свободна, проверка продолжается
-        return 2;
-    
-    if (Colour == Game.CurrentColour){
-        if (SafetyInfo.Ally)
-            return 1; // По направлению стоит больше одного союзника, проверка останавливается
-        else{
-            SafetyInfo.Ally = this;
-            return 2; // По направлению стоит союзник, его адрес запоминается, проверка продолжается
-        }
-    }
+    if (first >= argc)
+        return StartPositionFEN;
     
-    if (Name != Queen && Name != Rook)
-        return 1; // Обнаружена безопасная вражеская фигура, проверка останавливается
-    
-    if (SafetyInfo.Ally != 0){ // Обнаружена опасная вражеская фигура, блокирующая союзную фигуру
-        switch (mode){
-            case 0: 
-                return 1; // Клетка считается подходящей для перемещения короля, проверка останавливается
-            case 1:
-                // Блокированная фигура записывается для дальнейшей корректировки, проверка останавливается
-                SafetyInfo.Ally -> writesquare(SafetyInfo.Pinned, 1);
-                writestep(SafetyInfo.Pinned, step);
-                writesquare(SafetyInfo.Pinned, 1);
-                return 1;
-        }
-    }
-    
-    if (SafetyInfo.Ally == 0){ // Обнаружена опасная вражеская фигура, дающая шах королю
-        switch (mode){
-            case 0:
-                return 0; //Клетка считается неподходящей для перемещения короля, проверка останавливается
-            case 1:
-                // Вражеская фигура добавляется к атакующим для дальнейшей корректировки, проверка останавливается
-                SafetyInfo.Attackers++;
-                writesquare(SafetyInfo.Threats);
-                writestep(SafetyInfo.Threats, -step);
-                return 1;
-        }
+    buffer[0] = '\0';
+    for (int i = first; i < argc; i++){
+        if ((int) (strlen(buffer) + strlen(argv[i]) + 2) > size)
+            break;
+        if (i > first)
+            strcat(buffer, " ");
+        strcat(buffer, argv[i]);
     }
-    return 1;
+    return buffer;
 }
 
-// Аналогичная предыдущей функция для слона и ферзя
-int cell :: bishop_threat (int mode, int step, king_safety& SafetyInfo)
+// Извлечение из аргументов командной строки параметра вида "--name <число>"
+// Найденный параметр удаляется из argv, чтобы не мешать разбору режимов запуска
+int take_option (int& argc, char* argv[], const char* name, int Default)
 {
-    if (Colour == NoColour) // Клетка свободна, проверка продолжается
-        return 2;
-    
-    if (Colour == Game.CurrentColour){
-        if (SafetyInfo.Ally)
-            return 1; // По направлению стоит больше одного союзника, проверка останавливается
-        else{
-            SafetyInfo.Ally = this;
-            return 2; // По направлению стоит союзник, его адрес запоминается, проверка продолжается
-        }
-    }
-    
-    if (Name != Queen && Name != Bishop)
-        return 1; // Обнаружена безопасная вражеская фигура, проверка останавливается
-    
-    if (SafetyInfo.Ally != 0){ // Обнаружена опасная вражеская фигура, блокирующая союзную фигуру
-        switch (mode){
-            case 0: 
-                return 1; // Клетка считается подходящей для перемещения короля, проверка останавливается
-            case 1:
-                // Блокированная фигура записывается для дальнейшей корректировки, проверка останавливается
-                SafetyInfo.Ally -> writesquare(SafetyInfo.Pinned, 1);
-                writestep(SafetyInfo.Pinned, step);
-                writesquare(SafetyInfo.Pinned, 1);
-                return 1;
-        }
-    }
-    
-    if (SafetyInfo.Ally == 0){ // Обнаружена опасная вражеская фигура, дающая шах королю
-        switch (mode){
-            case 0:
-                return 0; //Клетка считается неподходящей для перемещения короля, проверка останавливается
-            case 1:
-                // Вражеская фигура добавляется к атакующим для дальнейшей корректировки, проверка останавливается
-                SafetyInfo.Attackers++;
-                writesquare(SafetyInfo.Threats);
-                writestep(SafetyInfo.Threats, -step);
-                return 1;
+    for (int i = 1; i + 1 < argc; i++){
+        if (!strcmp(argv[i], name)){
+            int Value = atoi(argv[i + 1]);
+            
+            for (int j = i; j + 2 < argc; j++)
+                argv[j] = argv[j + 2];
+            argc -= 2;
+            return Value;
         }
     }
-    return 1;
+    return Default;
 }
 
-// Проверка, атакована ли клетка пешкой
-int cell :: pawn_threat (int mode, int step, king_safety& SafetyInfo)
+// Извлечение из аргументов командной строки параметра-флага без значения
+bool take_flag (int& argc, char* argv[], const char* name)
 {
-    if (step == StepUp + StepLeft || step == StepUp + StepRight){
-        if (Colour == Black && Name == Pawn && Game.CurrentColour == White){
-            switch (mode){
-                case 0:
-                    return 0;
-                case 1:
-                    writesquare (SafetyInfo.Threats);
-                    strcat (SafetyInfo.Threats, "Pw"); // Пешка атакует на расстоянии одной клетки, шаг направления не нужен
-                    SafetyInfo.Attackers++;
-                    return 1;
-            }
-        }
-    }
-    if (step == StepDown + StepLeft || step == StepDown + StepRight){
-        if (Colour == White && Name == Pawn && Game.CurrentColour == Black){
-            switch (mode){
-                case 0:
-                    return 0;
-                case 1:
-                    writesquare(SafetyInfo.Threats);
-                    strcat (SafetyInfo.Threats, "Pw"); // Пешка атакует на расстоянии одной клетки, шаг направления не нужен
-                    SafetyInfo.Attackers++;
-                    return 1;
-            }
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], name)){
+            for (int j = i; j + 1 < argc; j++)
+                argv[j] = argv[j + 1];
+            argc--;
+            return true;
         }
     }
-    return 1;
+    return false;
 }
 
-// Проверка, атакована ли клетка конем
-int cell :: knight_threat (int mode, king_safety& SafetyInfo)
+int main(int argc, char* argv[])
 {
-    if (Name != Knight)
-        return 2;
+    char command[16];
+    char FEN[256];
+    piece_colour ComputerColour = NoColour; // Цвет фигур, за которые играет компьютер
+    search_limits ComputerLimits;
+    static key_history History; // Ключи позиций партии для поиска хода компьютера
     
-    if (Colour != NoColour && Colour != Game.CurrentColour){
-        switch (mode){
-            case 0:
-                return 0;
-            case 1:
-                writesquare(SafetyInfo.Threats);
-                strcat(SafetyInfo.Threats, "Kn"); // Блокировать шах от коня невозможно, шаг направления не нужен
-                SafetyInfo.Attackers++;
-                return 1;
-        }
+    init_bitboards();
+    init_zobrist();
+    init_eval();
+    
+    // Статистика горячих участков при завершении программы: --stats (таблица) или --stats-json
+    if (take_flag(argc, argv, "--stats-json"))
+        report_stats_at_exit (true);
+    else if (take_flag(argc, argv, "--stats"))
+        report_stats_at_exit (false);
+    
+    // Размер таблицы транспозиций: --hash <МБ>
+    int HashSize = take_option(argc, argv, "--hash", 16);
+    if (HashSize < 1 || HashSize > MaxHashSize){
+        cout << "Размер таблицы транспозиций должен быть от 1 до " << MaxHashSize << " МБ" << '\n';
+        return 1;
     }
-    return 2;
-}
-
-/* Проверка безопасности короля. При mode = 0 (по умолчанию), проверяется, атакована ли клетка со всех возможных
-направлений. При mode = 1, проверка аналогична, но обрабатывается ситуация шаха и блокировки фигур */
-bool cell :: check_king(int mode)
-{
-    int step;
-    int threat_mode; // В эту переменную пишется результат проверки функций типа ..._threat()
-    cell *tempSquare = 0;
-    cell *SquareZero = &Board[0][0];
-    cell *SquareEnd = &Board[7][7];
-    char Headline[5] = "";
-    char KingEscape[17] = "";
-    king_safety SafetyInfo;
-    char* Pinned = 0;
-    
-    Headline[0] = '/';
-    writesquare(Headline);
-    Headline[3] = ':';
-    
-    // Проверка по вертикали и горизонтали
-    
-    if (Vertical_Coord < 7){
-        tempSquare = this + StepUp;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-        
-        for (step = StepUp; tempSquare -> Vertical_Coord <= 7 && tempSquare <= SquareEnd; tempSquare += step){
-            
-            threat_mode = tempSquare -> rook_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
+    if (!TT.resize (HashSize)){
+        cout << "Не хватает памяти для таблицы транспозиций размером " << HashSize << " МБ" << '\n';
+        return 1;
     }
     
-    if (Vertical_Coord > 0){
-        tempSquare = this + StepDown;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-        
-        for (step = StepDown; tempSquare -> Vertical_Coord >= 0 && tempSquare >= SquareZero; tempSquare += step){
-            threat_mode = tempSquare -> rook_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
+    // Количество потоков поиска: --threads <N>
+    int Threads = take_option(argc, argv, "--threads", 1);
+    if (Threads < 1 || Threads > MaxThreads){
+        cout << "Количество потоков должно быть от 1 до " << MaxThreads << '\n';
+        return 1;
     }
+    ComputerLimits.Threads = Threads;
     
-    if (Horizontal_Coord < 7){
-        tempSquare = this + StepRight;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-        
-        for (step = StepRight; tempSquare <= SquareEnd; tempSquare += step){
-            threat_mode = tempSquare -> rook_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
-    }
+    // Глубина поиска для пакетного режима: --depth <N>
+    int Depth = take_option(argc, argv, "--depth", 0);
     
-    if (Horizontal_Coord > 0){
-        tempSquare = this + StepLeft;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-        
-        for (step = StepLeft; tempSquare >= SquareZero; tempSquare += step){
-            threat_mode = tempSquare -> rook_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
+    // Работа по протоколу UCI: chess --uci
+    if (argc > 1 && !strcmp(argv[1], "--uci")){
+        uci_loop (Threads);
+        return 0;
     }
     
-    // Проверка по диагоналям
+    // Сервер партий: chess --server [порт TCP|путь к сокету Unix], без адреса - стандартный ввод и вывод
+    if (argc > 1 && !strcmp(argv[1], "--server"))
+        return run_server (argc > 2 ? argv[2] : 0) ? 0 : 1;
     
-    if (Horizontal_Coord > 0 && Vertical_Coord < 7){
-        tempSquare = this + StepUp + StepLeft;
-        
-        if (tempSquare -> pawn_threat(mode, step, SafetyInfo) == 0)
-            return false;
+    // Запуск в режиме perft: chess --perft <глубина> [FEN]
+    if (argc > 1 && !strcmp(argv[1], "--perft")){
+        int depth = argc > 2 ? atoi(argv[2]) : 0;
         
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-        
-        for (step = StepUp + StepLeft; tempSquare -> Vertical_Coord <= 7 && tempSquare >= SquareZero; tempSquare += step){
-            threat_mode = tempSquare -> bishop_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
+        if (depth < 1){
+            cout << "Использование: " << argv[0] << " --perft <глубина> [FEN]" << '\n';
+            return 1;
         }
-        SafetyInfo.Ally = 0;
-    }
-    
-    if (Horizontal_Coord < 7 && Vertical_Coord < 7){
-        tempSquare = this + StepUp + StepRight;
-        
-        if (tempSquare -> pawn_threat(mode, step, SafetyInfo) == 0)
-            return false;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
         
-        for (step = StepUp + StepRight; tempSquare -> Vertical_Coord <= 7 && tempSquare <= SquareEnd; tempSquare += step){
-            threat_mode = tempSquare -> bishop_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
+        return run_perft (depth, join_args(argc, argv, 3, FEN, sizeof(FEN))) ? 0 : 1;
     }
     
-    if (Horizontal_Coord > 0 && Vertical_Coord > 0){
-        tempSquare = this + StepDown + StepLeft;
-        
-        if (tempSquare -> pawn_threat(mode, step, SafetyInfo) == 0)
-            return false;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-       
-        for (step = StepDown + StepLeft; tempSquare -> Vertical_Coord <= 7 && tempSquare >= SquareZero; tempSquare += step){
-            threat_mode = tempSquare -> bishop_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
+    // Потоковая обработка файла позиций: chess --fens <файл> [глубина perft]
+    if (argc > 1 && !strcmp(argv[1], "--fens")){
+        if (argc < 3){
+            cout << "Использование: " << argv[0] << " --fens <файл> [глубина perft]" << '\n';
+            return 1;
         }
-        SafetyInfo.Ally = 0;
-    }
-    
-    if (Horizontal_Coord < 7 && Vertical_Coord > 0){
-        tempSquare = this + StepDown + StepRight;
         
-        if (tempSquare -> pawn_threat(mode, step, SafetyInfo) == 0)
-            return false;
-        
-        if (tempSquare -> king_threat(mode) == 0)
-            return false;
-       
-        for (step = StepDown + StepRight; tempSquare -> Vertical_Coord <= 7 && tempSquare >= SquareZero; tempSquare += step){
-            threat_mode = tempSquare -> bishop_threat(mode, step, SafetyInfo);
-            if (threat_mode == 0)
-                return false;
-            if (threat_mode == 1)
-                break;
-        }
-        SafetyInfo.Ally = 0;
+        return run_fens (argv[2], argc > 3 ? atoi(argv[3]) : 0) ? 0 : 1;
     }
     
-    // Проверка коней
-    
-    if (Vertical_Coord > 0 && Horizontal_Coord > 1){
-        tempSquare = this + 2*StepLeft + StepDown;
+    // Чтение базы партий: chess --pgn <файл>
+    if (argc > 1 && !strcmp(argv[1], "--pgn")){
+        if (argc < 3){
+            cout << "Использование: " << argv[0] << " --pgn <файл>" << '\n';
+            return 1;
+        }
         
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
+        return run_pgn (argv[2]) ? 0 : 1;
     }
     
-    if (Vertical_Coord > 0 && Horizontal_Coord < 6){
-        tempSquare = this + 2*StepRight + StepDown;
-        
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-            
-    if (Vertical_Coord < 7 && Horizontal_Coord > 1){
-        tempSquare = this + 2*StepLeft + StepUp;
-        
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-            
-    if (Vertical_Coord < 7 && Horizontal_Coord < 6){
-        tempSquare = this + 2*StepRight + StepUp;
-        
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-            
-    if (Vertical_Coord > 1 && Horizontal_Coord > 0){ 
-        tempSquare = this + StepLeft + 2*StepDown;
+    // Упаковка позиций в двоичный формат и обратно: chess --pack|--unpack <входной файл> <выходной файл>
+    if (argc > 1 && (!strcmp(argv[1], "--pack") || !strcmp(argv[1], "--unpack"))){
+        if (argc < 4){
+            cout << "Использование: " << argv[0] << " " << argv[1] << " <входной файл> <выходной файл>" << '\n';
+            return 1;
+        }
         
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
+        if (!strcmp(argv[1], "--pack"))
+            return run_pack (argv[2], argv[3]) ? 0 : 1;
+        return run_unpack (argv[2], argv[3]) ? 0 : 1;
     }
-            
-    if (Vertical_Coord > 1 && Horizontal_Coord < 7){ 
-        tempSquare = this + StepRight + 2*StepDown;
+    
+    // Прогон набора тестовых позиций: chess --epd <файл> [время на позицию в мс] [--depth <глубина>]
+    if (argc > 1 && !strcmp(argv[1], "--epd")){
+        search_limits Limits;
         
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-            
-    if (Vertical_Coord < 6 && Horizontal_Coord > 0){ 
-        tempSquare = this + StepLeft + 2*StepUp;
+        if (argc < 3){
+            cout << "Использование: " << argv[0] << " --epd <файл> [время на позицию в мс] [--depth <глубина>]" << '\n';
+            return 1;
+        }
         
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-            
-    if (Vertical_Coord < 6 && Horizontal_Coord < 7){ 
-        tempSquare = this + StepRight + 2*StepUp;
+        Limits.Threads = Threads;
+        Limits.MoveTime = argc > 3 ? atoi(argv[3]) : (Depth > 0 ? 0 : 1000);
+        if (Depth > 0)
+            Limits.Depth = Depth;
         
-        if (tempSquare -> knight_threat(mode, SafetyInfo) == 0)
-            return false;
-    }
-    
-    // По завершению проверки происходит корректировка Game.CorrectMoves
-    switch (mode){
-        case 0:
-            return true;
-        case 1:
-            if (SafetyInfo.Attackers > 1){ 
-                // При атаке двумя фигурами блокировка шаха невозможна, остаются только ходы короля
-                for (char* p = Game.CorrectMoves; *p; p++)
-                    *p = '\0';
-                
-                king_moves (KingEscape);
-                
-                if (strcmp(KingEscape, "")){
-                    strcat(Game.CorrectMoves, Headline);
-                    strcat(Game.CorrectMoves, KingEscape);
-                }
-                return false;
-            }
-            
-            if (SafetyInfo.Attackers == 1){
-                // Обработка шаха от одной фигуры
-                SafetyInfo.Threats[4] = 'a' + char(Horizontal_Coord);
-                SafetyInfo.Threats[5] = '1' + char(Vertical_Coord);
-                threat_block (SafetyInfo.Threats); // Блокировка шаха
-                king_moves (KingEscape); // Добавление ходов короля
-                
-                if (strcmp(KingEscape, "")){
-                    strcat(Game.CorrectMoves, Headline);
-                    strcat(Game.CorrectMoves, KingEscape);
-                }
-                
-                if (strcmp(Game.CorrectMoves, "") && strcmp(SafetyInfo.Pinned, "")){
-                    Pinned = SafetyInfo.Pinned;
-                    while (*Pinned){
-                        pinned_exclude (Pinned); // Исключение блокированных фигур
-                        Pinned += 6;
-                    }
-                }
-                
-                return false;
-            }
-            
-            // Шаха нет, но производится исключение блокированных фигур
-            if (strcmp(SafetyInfo.Pinned, "")){
-                Pinned = SafetyInfo.Pinned;
-                    while (*Pinned){
-                        pinned_exclude (Pinned);
-                        Pinned += 6;
-                    }
-                return true;
-            }
-    }
-    return true;
-}
-
-// Расчет всех возможных ходов для всех клеток
-bool count_moves ()
-{
-    bool NoCheck = true;
-    
-    // Проверка фигур осуществляется из массива Game.PiecePointer, начиная с индекса, соответствующего цвету (0 / 16)
-    int count = (int) Game.CurrentColour;
-    
-    cell* Piece = 0;
-    
-    for (char *p = Game.CorrectMoves; *p; p++) // Очистка строки
-        *p = '\0';
-    
-    for (int i = 0; i < 16; i++, count++){
-        Piece = Game.PiecePointer[count];
-        if (Piece)
-            Piece -> movement_list(); // Если фигура есть на доске, для нее рассчитываются и пишутся все ходы
-    }
-    
-    NoCheck = Piece -> check_king(1); // Полная проверка текущего положения короля
-    
-    if (!strcmp(Game.CorrectMoves, "") && NoCheck){
-        cout << "Пат, ничья, игра окончена";
-        return false;
+        return run_epd (argv[2], Limits) ? 0 : 1;
     }
     
-    if (!strcmp(Game.CorrectMoves, "") && !NoCheck){
-        cout << "Шах и мат, игра окончена";
-        return false;
-    }
-    
-    if (NoCheck)
-        check_castle();
-    
-    //cout << Game.CorrectMoves << '\n';
-    return true;
-}
-
-// Проверка введенной команды на правильность
-bool read_command (char* command)
-{   
-    char *count;
-    int h1, h2, v1, v2;
-    
-    if (strlen(command) == 4){
-        if (command[0] < 'a' || command[0] > 'h') return false;
-        if (command[1] < '1' || command[1] > '8') return false;
-        if (command[0] < 'a' || command[0] > 'h') return false;
-        if (command[3] < '1' || command[3] > '8') return false;
-    }
-    
-    if (strlen(command) == 3 && strcmp(command, "O-O")) return false;
-    
-    if (strlen(command) == 5 && strcmp(command, "O-O-O")) return false;
-    
-    // Поиск в Game.CorrectMoves хода O-O
-    if (!strcmp(command, "O-O")){
-        for (count = Game.CorrectMoves; *count; count++)
-            if (*count == 'O')
-                if (*(count + 1) == '-' && *(count + 2) == 'O' && *(count + 3) != '-'){
-                    short_castle();
-                    return true;
-                }
-    }
-    
-    // Поиск в Game.CorrectMoves хода O-O-O
-    if (!strcmp(command, "O-O-O")){
-        for (count = Game.CorrectMoves; *count; count++)
-            if (*count == 'O')
-                if (*(count + 1) == '-', *(count + 2) == 'O', *(count + 3) == '-', *(count + 4) == 'O'){
-                    long_castle();
-                    return true;
-                }
-    }
-    
-    // Поиск в Game.CorrectMoves исходной клетки введенного хода
-    for (count = Game.CorrectMoves; *(count + 1); count++){
-        if (*count == '/'){
-            if (*(count + 1) == command[0] && *(count + 2) == command[1]){
-                count += 4;
-                break;
-            }
+    // Запуск в режиме анализа: chess --search <время в мс> [FEN]
+    if (argc > 1 && !strcmp(argv[1], "--search")){
+        int MoveTime = argc > 2 ? atoi(argv[2]) : 0;
+        
+        if (MoveTime < 1){
+            cout << "Использование: " << argv[0] << " --search <время в мс> [FEN]" << '\n';
+            return 1;
         }
+        
+        return run_search (MoveTime, Threads, join_args(argc, argv, 3, FEN, sizeof(FEN))) ? 0 : 1;
     }
     
-    if (!*(count + 1)){
-        cout << '\n' << "Неправильный ход" << '\n';
-        return false;
-    }
-    
-    // Поиск в Game.CorrectMoves конечной введенной клетки
-    for (; *count != '/'; count += 2){
-        if (*count == command[2] && *(count + 1) == command[3]){
-            h2 = int(command[0]) - int('a');
-            v2 = int(command[1]) - int('1');
-            h1 = int(command[2]) - int('a');
-            v1 = int(command[3]) - int('1');
-            Board[h1][v1] = Board[h2][v2];
-            return true;
+    // Игра против компьютера: chess --computer <white|black> [время на ход в мс]
+    if (argc > 1 && !strcmp(argv[1], "--computer")){
+        if (argc > 2 && !strcmp(argv[2], "white"))
+            ComputerColour = White;
+        if (argc > 2 && !strcmp(argv[2], "black"))
+            ComputerColour = Black;
+        
+        if (ComputerColour == NoColour){
+            cout << "Использование: " << argv[0] << " --computer <white|black> [время на ход в мс]" << '\n';
+            return 1;
         }
+        
+        ComputerLimits.MoveTime = argc > 3 ? atoi(argv[3]) : 1000;
     }
-    cout << '\n' << "Неправильный ход" << '\n';
-    return false;
-}
-
-int main()
-{
-    char command[6];
     
-    init_board();
-    load_FEN (startFEN);
+    Game.start();
     show_board();
     
     while (count_moves()){
         
+        if (Game.Pos.CurrentColour == ComputerColour){
+            Game.history (History);
+            search_report Result = think (Game.Pos, ComputerLimits, print_report, &History);
+            
+            move_to_string (Result.BestMove, command);
+            cout << "Ход компьютера: " << command << '\n';
+            Game.play (Result.BestMove);
+            show_board();
+            continue;
+        }
+        
         do {
             cout << "Ваш ход:";
-            cin >> command;
+            cin >> setw(sizeof(command)) >> command;
+            
+            if (!cin) // Ввод закончился
+                return 0;
+            
+            // Оболочка, запустившая программу без параметров, переводит ее в режим UCI первой командой
+            if (!strcmp(command, "uci")){
+                uci_loop (Threads, command);
+                return 0;
+            }
         }while (!read_command (command));
         
-        if (Game.CurrentColour == White)
-            Game.CurrentColour = Black;
-        else
-            Game.CurrentColour = White;
-        
         show_board();
     }
     
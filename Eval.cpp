@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <cstdlib>
+#include "Eval.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Стоимость фигур и таблицы клеток (PeSTO). Таблицы записаны с точки зрения белых, первая строка - восьмая горизонталь
+static const int PieceValueMg[6] = {82, 337, 365, 477, 1025, 0};
+static const int PieceValueEg[6] = {94, 281, 297, 512, 936, 0};
+
+static const int SquareTableMg[6][64] = {
+    { // Пешка
+          0,   0,   0,   0,   0,   0,   0,   0,
+         98, 134,  61,  95,  68, 126,  34, -11,
+         -6,   7,  26,  31,  65,  56,  25, -20,
+        -14,  13,   6,  21,  23,  12,  17, -23,
+        -27,  -2,  -5,  12,  17,   6,  10, -25,
+        -26,  -4,  -4, -10,   3,   3,  33, -12,
+        -35,  -1, -20, -23, -15,  24,  38, -22,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    { // Конь
+       -167, -89, -34, -49,  61, -97, -15,-107,
+        -73, -41,  72,  36,  23,  62,   7, -17,
+        -47,  60,  37,  65,  84, 129,  73,  44,
+         -9,  17,  19,  53,  37,  69,  18,  22,
+        -13,   4,  16,  13,  28,  19,  21,  -8,
+        -23,  -9,  12,  10,  19,  17,  25, -16,
+        -29, -53, -12,  -3,  -1,  18, -14, -19,
+       -105, -21, -58, -33, -17, -28, -19, -23
+    },
+    { // Слон
+        -29,   4, -82, -37, -25, -42,   7,  -8,
+        -26,  16, -18, -13,  30,  59,  18, -47,
+        -16,  37,  43,  40,  35,  50,  37,  -2,
+         -4,   5,  19,  50,  37,  37,   7,  -2,
+         -6,  13,  13,  26,  34,  12,  10,   4,
+          0,  15,  15,  15,  14,  27,  18,  10,
+          4,  15,  16,   0,   7,  21,  33,   1,
+        -33,  -3, -14, -21, -13, -12, -39, -21
+    },
+    { // Ладья
+         32,  42,  32,  51,  63,   9,  31,  43,
+         27,  32,  58,  62,  80,  67,  26,  44,
+         -5,  19,  26,  36,  17,  45,  61,  16,
+        -24, -11,   7,  26,  24,  35,  -8, -20,
+        -36, -26, -12,  -1,   9,  -7,   6, -23,
+        -45, -25, -16, -17,   3,   0,  -5, -33,
+        -44, -16, -20,  -9,  -1,  11,  -6, -71,
+        -19, -13,   1,  17,  16,   7, -37, -26
+    },
+    { // Ферзь
+        -28,   0,  29,  12,  59,  44,  43,  45,
+        -24, -39,  -5,   1, -16,  57,  28,  54,
+        -13, -17,   7,   8,  29,  56,  47,  57,
+        -27, -27, -16, -16,  -1,  17,  -2,   1,
+         -9, -26,  -9, -10,  -2,  -4,   3,  -3,
+        -14,   2, -11,  -2,  -5,   2,  14,   5,
+        -35,  -8,  11,   2,   8,  15,  -3,   1,
+         -1, -18,  -9,  10, -15, -25, -31, -50
+    },
+    { // Король
+        -65,  23,  16, -15, -56, -34,   2,  13,
+         29,  -1, -20,  -7,  -8,  -4, -38, -29,
+         -9,  24,   2, -16, -20,   6,  22, -22,
+        -17, -20, -12, -27, -30, -25, -14, -36,
+        -49,  -1, -27, -39, -46, -44, -33, -51,
+        -14, -14, -22, -46, -44, -30, -15, -27,
+          1,   7,  -8, -64, -43, -16,   9,   8,
+        -15,  36,  12, -54,   8, -28,  24,  14
+    }
+};
+
+static const int SquareTableEg[6][64] = {
+    { // Пешка
+          0,   0,   0,   0,   0,   0,   0,   0,
+        178, 173, 158, 134, 147, 132, 165, 187,
+         94, 100,  85,  67,  56,  53,  82,  84,
+         32,  24,  13,   5,  -2,   4,  17,  17,
+         13,   9,  -3,  -7,  -7,  -8,   3,  -1,
+          4,   7,  -6,   1,   0,  -5,  -1,  -8,
+         13,   8,   8,  10,  13,   0,   2,  -7,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    { // Конь
+        -58, -38, -13, -28, -31, -27, -63, -99,
+        -25,  -8, -25,  -2,  -9, -25, -24, -52,
+        -24, -20,  10,   9,  -1,  -9, -19, -41,
+        -17,   3,  22,  22,  22,  11,   8, -18,
+        -18,  -6,  16,  25,  16,  17,   4, -18,
+        -23,  -3,  -1,  15,  10,  -3, -20, -22,
+        -42, -20, -10,  -5,  -2, -20, -23, -44,
+        -29, -51, -23, -15, -22, -18, -50, -64
+    },
+    { // Слон
+        -14, -21, -11,  -8,  -7,  -9, -17, -24,
+         -8,  -4,   7, -12,  -3, -13,  -4, -14,
+          2,  -8,   0,  -1,  -2,   6,   0,   4,
+         -3,   9,  12,   9,  14,  10,   3,   2,
+         -6,   3,  13,  19,   7,  10,  -3,  -9,
+        -12,  -3,   8,  10,  13,   3,  -7, -15,
+        -14, -18,  -7,  -1,   4,  -9, -15, -27,
+        -23,  -9, -23,  -5,  -9, -16,  -5, -17
+    },
+    { // Ладья
+         13,  10,  18,  15,  12,  12,   8,   5,
+         11,  13,  13,  11,  -3,   3,   8,   3,
+          7,   7,   7,   5,   4,  -3,  -5,  -3,
+          4,   3,  13,   1,   2,   1,  -1,   2,
+          3,   5,   8,   4,  -5,  -6,  -8, -11,
+         -4,   0,  -5,  -1,  -7, -12,  -8, -16,
+         -6,  -6,   0,   2,  -9,  -9, -11,  -3,
+         -9,   2,   3,  -1,  -5, -13,   4, -20
+    },
+    { // Ферзь
+         -9,  22,  22,  27,  27,  19,  10,  20,
+        -17,  20,  32,  41,  58,  25,  30,   0,
+        -20,   6,   9,  49,  47,  35,  19,   9,
+          3,  22,  24,  45,  57,  40,  57,  36,
+        -18,  28,  19,  47,  31,  34,  39,  23,
+        -16, -27,  15,   6,   9,  17,  10,   5,
+        -22, -23, -30, -16, -16, -23, -36, -32,
+        -33, -28, -22, -43,  -5, -32, -20, -41
+    },
+    { // Король
+        -74, -35, -18, -18, -11,  15,   4, -17,
+        -12,  17,  14,  17,  17,  38,  23,  11,
+         10,  17,  23,  15,  20,  45,  44,  13,
+         -8,  22,  24,  27,  26,  33,  26,   3,
+        -18,  -4,  21,  24,  27,  23,   9, -11,
+        -19,  -3,  11,  21,  23,  16,   7,  -9,
+        -27, -11,   4,  13,  14,   4,  -5, -17,
+        -53, -34, -21, -11, -28, -14, -24, -43
+    }
+};
+
+// Подвижность: оценка за каждую доступную клетку сверх среднего для фигуры количества
+static const score MobilityBonus[6] = {0, make_score(4, 4), make_score(5, 5), make_score(2, 4), make_score(1, 2), 0};
+static const int MobilityBase[6] = {0, 4, 6, 7, 13, 0};
+
+// Пешечная структура
+static const score DoubledPawn = make_score(-10, -25);
+static const score IsolatedPawn = make_score(-8, -15);
+static const score BackwardPawn = make_score(-8, -10);
+static const score PassedPawn[8] = {0, make_score(0, 10), make_score(5, 15), make_score(10, 25),
+                                    make_score(25, 50), make_score(45, 90), make_score(70, 140), 0};
+
+// Проходные пешки в эндшпиле: вес расстояний от королей до клетки перед пешкой по горизонтали пешки
+// и бонус пешке, которую король противника уже не догонит
+static const int PassedKingWeight[8] = {0, 0, 0, 1, 2, 4, 6, 0};
+static const score UnstoppablePasser = make_score(0, 600);
+
+// Безопасность короля: вес фигур, атакующих клетки рядом с королем, и пешечное прикрытие
+static const int KingAttackWeight[6] = {0, 2, 2, 3, 5, 0};
+static const score PawnShield = make_score(12, 0);
+
+// Заполнение таблиц PSQ: для черных клетки отражаются по вертикали
+void init_eval ()
+{
+    for (int n = Pawn; n < NoName; n++)
+        for (int sq = 0; sq < 64; sq++){
+            PSQ[White][n][sq] = make_score(PieceValueMg[n] + SquareTableMg[n][sq ^ 56], PieceValueEg[n] + SquareTableEg[n][sq ^ 56]);
+            PSQ[Black][n][sq] = -make_score(PieceValueMg[n] + SquareTableMg[n][sq], PieceValueEg[n] + SquareTableEg[n][sq]);
+        }
+}
+
+// Маска вертикали клетки и соседних с ней вертикалей
+static inline bitboard file_bb (int sq) {return FileA << square_hor(sq);}
+static inline bitboard adjacent_files (int sq) {return shift_left(file_bb(sq)) | shift_right(file_bb(sq));}
+
+// Клетки впереди пешки на ее вертикали и соседних с точки зрения цвета c
+static inline bitboard forward_span (piece_colour c, int sq)
+{
+    bitboard Ahead = c == White ? ~((bitboard(1) << (8 * square_vert(sq) + 8)) - 1)
+                                : (bitboard(1) << (8 * square_vert(sq))) - 1;
+    return (file_bb(sq) | adjacent_files(sq)) & Ahead;
+}
+
+// Клетки на соседних вертикалях не впереди пешки: только пешки на них могут ее защитить
+static inline bitboard support_span (piece_colour c, int sq)
+{
+    return adjacent_files(sq) & ~forward_span(c, sq);
+}
+
+// Оценка пешечной структуры одного цвета: сдвоенные, изолированные, отсталые и проходные пешки
+// Отсталая пешка не может быть защищена соседними пешками, а клетка перед ней атакована пешкой противника
+static score evaluate_pawns (const position& Pos, piece_colour Us, bitboard& Passed)
+{
+    piece_colour Them = opposite(Us);
+    bitboard Ours = Pos.pieces(Us, Pawn);
+    bitboard Theirs = Pos.pieces(Them, Pawn);
+    score Result = 0;
+
+    Passed = 0;
+    for (bitboard b = Ours; b; ){
+        int sq = pop_first(b);
+        int Rank = Us == White ? square_vert(sq) : 7 - square_vert(sq);
+        int Stop = Us == White ? sq + 8 : sq - 8;
+        bitboard Front = forward_span(Us, sq);
+
+        if (Front & file_bb(sq) & Ours)
+            Result += DoubledPawn;
+
+        if (!(adjacent_files(sq) & Ours))
+            Result += IsolatedPawn;
+        else if (!(support_span(Us, sq) & Ours) && (pawn_attacks(Us, Stop) & Theirs))
+            Result += BackwardPawn;
+
+        if (!(Front & Theirs) && !(Front & file_bb(sq) & Ours)){
+            Result += PassedPawn[Rank];
+            Passed |= square_bb(sq);
+        }
+    }
+    return Result;
+}
+
+// Поиск пешечной структуры в таблице
+const pawn_entry& pawn_table :: probe (const position& Pos)
+{
+    pawn_entry& Entry = Entries[Pos.PawnKey & (PawnTableSize - 1)];
+
+    Probes.store(Probes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    if (Entry.Key == Pos.PawnKey){
+        Hits.store(Hits.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return Entry;
+    }
+
+    Entry.Key = Pos.PawnKey;
+    Entry.Score = evaluate_pawns(Pos, White, Entry.Passed[White]) - evaluate_pawns(Pos, Black, Entry.Passed[Black]);
+    return Entry;
+}
+
+// Расстояние между клетками в ходах короля
+static inline int distance (int a, int b)
+{
+    return max(abs(square_hor(a) - square_hor(b)), abs(square_vert(a) - square_vert(b)));
+}
+
+// Проходные пешки цвета Us по маскам из пешечной таблицы. Эта часть зависит от королей и фигур,
+// поэтому в таблице не хранится. Близость своего короля к клетке перед пешкой помогает ей, короля противника - мешает
+// Если у противника остались только король и пешки, путь пешки свободен, а король не успевает
+// к клетке превращения (правило квадрата), пешка превратится в ферзя
+static score evaluate_passed (const position& Pos, piece_colour Us, bitboard Passed)
+{
+    piece_colour Them = opposite(Us);
+    int OurKing = Pos.king_square(Us), TheirKing = Pos.king_square(Them);
+    bool PawnEnding = Pos.Colours[Them] == (Pos.pieces(Them, Pawn) | Pos.pieces(Them, King));
+    score Result = 0;
+
+    for (bitboard b = Passed; b; ){
+        int sq = pop_first(b);
+        int Rank = Us == White ? square_vert(sq) : 7 - square_vert(sq);
+        int Stop = Us == White ? sq + 8 : sq - 8;
+
+        Result += make_score(0, PassedKingWeight[Rank] * (5 * distance(TheirKing, Stop) - 2 * distance(OurKing, Stop)));
+
+        if (!PawnEnding)
+            continue;
+
+        // С начальной горизонтали пешка проходит две клетки за ход
+        int Queening = make_square(square_hor(sq), Us == White ? 7 : 0);
+        int PawnMoves = 7 - Rank - (Rank == 1);
+        int KingMoves = distance(TheirKing, Queening) - (Pos.CurrentColour == Them);
+
+        if (KingMoves > PawnMoves && !((Between[sq][Queening] | square_bb(Queening)) & Pos.Occupied))
+            Result += UnstoppablePasser;
+    }
+    return Result;
+}
+
+// Подвижность фигур одного цвета и их атаки на клетки рядом с королем противника
+// Доступными считаются клетки, не занятые своими фигурами и не атакованные пешками противника
+static score evaluate_pieces (const position& Pos, piece_colour Us, int& AttackUnits, int& Attackers)
+{
+    piece_colour Them = opposite(Us);
+    int TheirKing = Pos.king_square(Them);
+    bitboard KingZone = king_attacks(TheirKing) | square_bb(TheirKing);
+    bitboard PawnAttacked = 0;
+    score Result = 0;
+
+    for (bitboard b = Pos.pieces(Them, Pawn); b; )
+        PawnAttacked |= pawn_attacks(Them, pop_first(b));
+
+    bitboard Available = ~Pos.Colours[Us] & ~PawnAttacked;
+
+    for (int n = Knight; n <= Queen; n++)
+        for (bitboard b = Pos.pieces(Us, piece_name(n)); b; ){
+            int sq = pop_first(b);
+            bitboard Attacks;
+
+            switch (n){
+                case Knight: Attacks = knight_attacks(sq); break;
+                case Bishop: Attacks = bishop_attacks(sq, Pos.Occupied); break;
+                case Rook: Attacks = rook_attacks(sq, Pos.Occupied); break;
+                default: Attacks = bishop_attacks(sq, Pos.Occupied) | rook_attacks(sq, Pos.Occupied); break;
+            }
+
+            Result += MobilityBonus[n] * (pop_count(Attacks & Available) - MobilityBase[n]);
+
+            if (Attacks & KingZone){
+                Attackers++;
+                AttackUnits += KingAttackWeight[n] * pop_count(Attacks & KingZone);
+            }
+        }
+    return Result;
+}
+
+// Безопасность короля цвета Us: пешечное прикрытие и штраф за атаки на соседние с ним клетки
+// Штраф растет квадратично, одиночная атакующая фигура опасности почти не представляет
+static score evaluate_king (const position& Pos, piece_colour Us, int AttackUnits, int Attackers)
+{
+    int KingSquare = Pos.king_square(Us);
+    bitboard Front = Us == White ? shift_up(king_attacks(KingSquare) | square_bb(KingSquare))
+                                 : shift_down(king_attacks(KingSquare) | square_bb(KingSquare));
+    score Result = PawnShield * min(pop_count(Front & Pos.pieces(Us, Pawn)), 3);
+
+    if (Attackers >= 2)
+        Result -= make_score(min(AttackUnits * AttackUnits, 500), 0);
+    return Result;
+}
+
+// Статическая оценка позиции
+int evaluate (const position& Pos, pawn_table& Pawns)
+{
+    int AttackUnits[2] = {0, 0}, Attackers[2] = {0, 0};
+
+    STAT_TIMER(TimerEvaluate);
+    STAT_COUNT(StatEvaluate);
+
+    const pawn_entry& PawnEntry = Pawns.probe(Pos);
+    score Total = Pos.PSQScore + PawnEntry.Score;
+
+    Total += evaluate_passed(Pos, White, PawnEntry.Passed[White]) - evaluate_passed(Pos, Black, PawnEntry.Passed[Black]);
+
+    Total += evaluate_pieces(Pos, White, AttackUnits[White], Attackers[White])
+           - evaluate_pieces(Pos, Black, AttackUnits[Black], Attackers[Black]);
+    Total += evaluate_king(Pos, White, AttackUnits[Black], Attackers[Black])
+           - evaluate_king(Pos, Black, AttackUnits[White], Attackers[White]);
+
+    int Phase = min(Pos.Phase, MaxPhase);
+    int Score = (mg_value(Total) * Phase + eg_value(Total) * (MaxPhase - Phase)) / MaxPhase;
+
+    return Pos.CurrentColour == White ? Score : -Score;
+}
@@ -0,0 +1,40 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <atomic>
+#include "Position.h"
+
+// Запись пешечной таблицы: оценка пешечной структуры с точки зрения белых и маски проходных пешек
+struct pawn_entry {
+    uint64_t Key;
+    score Score;
+    bitboard Passed[2];
+};
+
+const int PawnTableSize = 16384; // Количество записей, степень двойки
+
+// Пешечная хеш-таблица. Пешки двигаются редко, поэтому одна и та же пешечная структура встречается
+// в огромном количестве позиций перебора, и ее оценка почти всегда берется из таблицы
+// Таблица не защищена от одновременного доступа: у каждого потока поиска она своя
+class pawn_table {
+    pawn_entry Entries[PawnTableSize];
+
+  public:
+    // Статистика обращений, читается другим потоком во время поиска
+    std::atomic<uint64_t> Probes{0};
+    std::atomic<uint64_t> Hits{0};
+
+    // Запись для пешечной структуры позиции, при отсутствии в таблице оценка вычисляется и сохраняется
+    const pawn_entry& probe (const position& Pos);
+};
+
+// Заполнение таблиц оценки фигур на клетках, вызывается один раз при запуске программы до загрузки позиций
+void init_eval ();
+
+// Статическая оценка позиции в сотых долях пешки с точки зрения ходящего игрока
+// Материал и оценка клеток берутся из позиции, где они обновляются при каждом ходе, пешечная структура
+// и проходные пешки - из пешечной таблицы потока. Подвижность фигур, безопасность короля и зависящая от королей
+// часть оценки проходных пешек вычисляются заново. Оценки дебюта и эндшпиля смешиваются пропорционально стадии игры
+int evaluate (const position& Pos, pawn_table& Pawns);
+
+#endif
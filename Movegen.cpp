@@ -0,0 +1,353 @@
+#include <algorithm>
+#include "Movegen.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Данные о безопасности короля, вычисляемые один раз перед построением ходов
+struct king_safety {
+    int KingSquare; // Клетка короля текущего игрока
+    bitboard Checkers; // Фигуры противника, дающие шах
+    bitboard Pinned; // Свои фигуры, связанные с королем: им доступны только ходы вдоль линии связки
+    bitboard Target; // Клетки, ход на которые не оставляет короля под шахом (взятие или закрытие)
+};
+
+// Поиск связанных фигур: между королем и дальнобойной фигурой противника стоит ровно одна фигура
+static bitboard pinned_pieces (const position& Pos, piece_colour Us, int KingSquare)
+{
+    piece_colour Them = opposite(Us);
+    bitboard Pinned = 0;
+    bitboard Snipers = (rook_attacks(KingSquare, 0) & (Pos.pieces(Them, Rook) | Pos.pieces(Them, Queen)))
+                     | (bishop_attacks(KingSquare, 0) & (Pos.pieces(Them, Bishop) | Pos.pieces(Them, Queen)));
+
+    while (Snipers){
+        bitboard Blockers = Between[KingSquare][pop_first(Snipers)] & Pos.Occupied;
+
+        if (pop_count(Blockers) == 1)
+            Pinned |= Blockers & Pos.Colours[Us];
+    }
+    STAT_ADD(StatPinnedPieces, pop_count(Pinned));
+    return Pinned;
+}
+
+// Запись в список ходов фигуры с клетки from на все клетки маски targets, ходы на клетки Enemy - взятия
+// Связанная фигура может двигаться только вдоль линии, соединяющей ее с королем
+static inline void add_moves (move_list& List, const king_safety& Safety, int from, bitboard targets, bitboard Enemy)
+{
+    if (Safety.Pinned & square_bb(from))
+        targets &= Line[Safety.KingSquare][from];
+
+    for (bitboard b = targets & Enemy; b; )
+        List.add(encode_move(from, pop_first(b), Capture));
+    for (bitboard b = targets & ~Enemy; b; )
+        List.add(encode_move(from, pop_first(b)));
+}
+
+// Запись в список ходов пешек, конечные клетки которых получены сдвигом исходных на step
+// Ход на последнюю горизонталь записывается четырьмя превращениями, начиная с ферзя
+static inline void add_pawn_moves (move_list& List, const king_safety& Safety, bitboard targets, int step, int flags = QuietMove)
+{
+    while (targets){
+        int to = pop_first(targets);
+        int from = to - step;
+
+        if ((Safety.Pinned & square_bb(from)) && !(Line[Safety.KingSquare][from] & square_bb(to)))
+            continue;
+
+        if (square_bb(to) & (Rank1 | Rank8))
+            for (int n = Queen; n >= Knight; n--)
+                List.add(encode_move(from, to, flags | Promotion | (n - Knight)));
+        else
+            List.add(encode_move(from, to, flags));
+    }
+}
+
+// Взятие на проходе. Законность проверяется прямо: после хода с доски уходят обе пешки, и король
+// не должен оказаться под ударом, в том числе по горизонтали, освобожденной сразу двумя пешками
+static void generate_en_passant (const position& Pos, move_list& List, const king_safety& Safety)
+{
+    piece_colour Us = Pos.CurrentColour;
+    piece_colour Them = opposite(Us);
+    int to = Pos.EpSquare;
+    int Captured = Us == White ? to - 8 : to + 8;
+
+    for (bitboard b = pawn_attacks(Them, to) & Pos.pieces(Us, Pawn); b; ){
+        int from = pop_first(b);
+        bitboard Occupied = (Pos.Occupied ^ square_bb(from) ^ square_bb(Captured)) | square_bb(to);
+
+        if (!(attackers_to(Pos, Safety.KingSquare, Occupied) & Pos.Colours[Them] & ~square_bb(Captured)))
+            List.add(encode_move(from, to, EnPassant));
+    }
+}
+
+// Ходы короля на клетки targets: клетка не должна быть атакована даже с учетом того, что король ее освободит
+static void generate_king_moves (const position& Pos, move_list& List, const king_safety& Safety, bitboard targets)
+{
+    piece_colour Them = opposite(Pos.CurrentColour);
+    bitboard Occupied = Pos.Occupied ^ square_bb(Safety.KingSquare);
+
+    targets &= king_attacks(Safety.KingSquare);
+    while (targets){
+        int to = pop_first(targets);
+
+        STAT_COUNT(StatKingMoveTests);
+        if (!(attackers_to(Pos, to, Occupied) & Pos.Colours[Them]))
+            List.add(encode_move(Safety.KingSquare, to, (Pos.Colours[Them] & square_bb(to)) ? Capture : QuietMove));
+    }
+}
+
+// Ходы всех фигур, кроме короля, на клетки из Safety.Target. Если Safety.Target содержит только фигуры
+// противника, строятся только взятия
+static void generate_piece_moves (const position& Pos, move_list& List, const king_safety& Safety)
+{
+    piece_colour Us = Pos.CurrentColour;
+    bitboard Enemy = Pos.Colours[opposite(Us)] & Safety.Target;
+    bitboard Empty = ~Pos.Occupied;
+    bitboard Pawns = Pos.pieces(Us, Pawn);
+    bitboard b;
+
+    // Ходы пешек: шаг вперед, двойной шаг с начальной горизонтали и взятия по диагонали
+    if (Us == White){
+        bitboard Single = shift_up(Pawns) & Empty;
+        add_pawn_moves(List, Safety, Single & Safety.Target, 8);
+        add_pawn_moves(List, Safety, shift_up(Single & Rank3) & Empty & Safety.Target, 16, DoublePush);
+        add_pawn_moves(List, Safety, shift_up(shift_left(Pawns)) & Enemy, 7, Capture);
+        add_pawn_moves(List, Safety, shift_up(shift_right(Pawns)) & Enemy, 9, Capture);
+    }
+    else{
+        bitboard Single = shift_down(Pawns) & Empty;
+        add_pawn_moves(List, Safety, Single & Safety.Target, -8);
+        add_pawn_moves(List, Safety, shift_down(Single & Rank6) & Empty & Safety.Target, -16, DoublePush);
+        add_pawn_moves(List, Safety, shift_down(shift_left(Pawns)) & Enemy, -9, Capture);
+        add_pawn_moves(List, Safety, shift_down(shift_right(Pawns)) & Enemy, -7, Capture);
+    }
+
+    // Связанный конь не может сойти с линии связки, поэтому ходов не имеет
+    for (b = Pos.pieces(Us, Knight) & ~Safety.Pinned; b; ){
+        int from = pop_first(b);
+        add_moves(List, Safety, from, knight_attacks(from) & Safety.Target, Enemy);
+    }
+
+    for (b = Pos.pieces(Us, Bishop) | Pos.pieces(Us, Queen); b; ){
+        int from = pop_first(b);
+        add_moves(List, Safety, from, bishop_attacks(from, Pos.Occupied) & Safety.Target, Enemy);
+    }
+
+    for (b = Pos.pieces(Us, Rook) | Pos.pieces(Us, Queen); b; ){
+        int from = pop_first(b);
+        add_moves(List, Safety, from, rook_attacks(from, Pos.Occupied) & Safety.Target, Enemy);
+    }
+}
+
+// Запись доступных рокировок. Король не должен находиться под шахом и проходить через атакованные клетки
+static void generate_castles (const position& Pos, move_list& List)
+{
+    piece_colour Us = Pos.CurrentColour;
+    piece_colour Them = opposite(Us);
+    int KingSquare = Pos.king_square(Us);
+    int Short = (Us == White) ? WhiteShortCastle : BlackShortCastle;
+    int Long = (Us == White) ? WhiteLongCastle : BlackLongCastle;
+
+    if (Pos.CastleRights & Short)
+        if (!(Pos.Occupied & (square_bb(KingSquare + 1) | square_bb(KingSquare + 2))))
+            if (!square_attacked(Pos, KingSquare + 1, Them) && !square_attacked(Pos, KingSquare + 2, Them))
+                List.add(encode_move(KingSquare, KingSquare + 2, ShortCastle));
+
+    if (Pos.CastleRights & Long)
+        if (!(Pos.Occupied & (square_bb(KingSquare - 1) | square_bb(KingSquare - 2) | square_bb(KingSquare - 3))))
+            if (!square_attacked(Pos, KingSquare - 1, Them) && !square_attacked(Pos, KingSquare - 2, Them))
+                List.add(encode_move(KingSquare, KingSquare - 2, LongCastle));
+}
+
+// Построение списка легальных ходов текущего игрока за один проход
+// Шахующие и связанные фигуры находятся заранее, поэтому ходы, оставляющие короля под шахом, не строятся вовсе
+static void generate (const position& Pos, move_list& List, bool CapturesOnly)
+{
+    piece_colour Us = Pos.CurrentColour;
+    piece_colour Them = opposite(Us);
+    bitboard Allowed = CapturesOnly ? Pos.Colours[Them] : ~Pos.Colours[Us];
+    king_safety Safety;
+
+    STAT_TIMER(TimerGenerate);
+    STAT_COUNT(StatGenerate);
+
+    Safety.KingSquare = Pos.king_square(Us);
+    Safety.Checkers = attackers_to(Pos, Safety.KingSquare, Pos.Occupied) & Pos.Colours[Them];
+    Safety.Pinned = pinned_pieces(Pos, Us, Safety.KingSquare);
+
+    List.Count = 0;
+    generate_king_moves(Pos, List, Safety, Allowed);
+
+    // При двойном шахе возможны только ходы короля
+    if (pop_count(Safety.Checkers) > 1){
+        STAT_COUNT(StatDoubleChecks);
+        STAT_ADD(StatMovesGenerated, List.Count);
+        return;
+    }
+
+    // При шахе ход должен взять шахующую фигуру или встать между ней и королем
+    if (Safety.Checkers){
+        STAT_COUNT(StatCheckEvasions);
+        Safety.Target = (Safety.Checkers | Between[Safety.KingSquare][first_square(Safety.Checkers)]) & Allowed;
+    }
+    else
+        Safety.Target = Allowed;
+
+    generate_piece_moves(Pos, List, Safety);
+
+    if (Pos.EpSquare != NoSquare)
+        generate_en_passant(Pos, List, Safety);
+
+    if (!Safety.Checkers && !CapturesOnly)
+        generate_castles(Pos, List);
+
+    STAT_ADD(StatMovesGenerated, List.Count);
+}
+
+void generate_moves (const position& Pos, move_list& List)
+{
+    generate(Pos, List, false);
+}
+
+void generate_captures (const position& Pos, move_list& List)
+{
+    generate(Pos, List, true);
+}
+
+// Стоимость фигур для оценки размена. Король дороже любого размена, поэтому взятие, после которого
+// короля можно побить, никогда не выгодно
+static const int SeeValue[7] = {100, 320, 330, 500, 900, 20000, 0};
+
+// Оценка размена: последовательность взятий строится по возрастанию стоимости бьющих фигур, после каждого
+// взятия атакующие фигуры определяются заново с учетом открывшихся линий (рентген)
+// Затем от конца последовательности к началу выбирается, продолжать размен или остановиться
+int see (const position& Pos, chess_move m)
+{
+    int from = move_from(m);
+    int to = move_to(m);
+    int Gain[32];
+    int depth = 0;
+    piece_colour Side = Pos.colour_on(from);
+    piece_name Attacker = Pos.piece_on(from);
+    bitboard Occupied = Pos.Occupied ^ square_bb(from);
+
+    STAT_COUNT(StatSee);
+
+    // При взятии на проходе побитая пешка стоит рядом с конечной клеткой
+    if (move_flags(m) == EnPassant){
+        Occupied ^= square_bb(Side == White ? to - 8 : to + 8);
+        Gain[0] = SeeValue[Pawn];
+    }
+    else
+        Gain[0] = SeeValue[Pos.piece_on(to)];
+
+    bitboard Attackers = attackers_to(Pos, to, Occupied) & Occupied;
+
+    for (Side = opposite(Side); depth < 31; Side = opposite(Side)){
+        bitboard Ours = Attackers & Pos.Colours[Side];
+        int n = Pawn;
+
+        if (!Ours)
+            break;
+        while (!(Ours & Pos.pieces(Side, piece_name(n))))
+            n++;
+
+        depth++;
+        Gain[depth] = SeeValue[Attacker] - Gain[depth - 1];
+
+        // Продолжение не изменит итог, если даже при лучшем исходе сторона остается в проигрыше
+        if (max(-Gain[depth - 1], Gain[depth]) < 0)
+            break;
+
+        Occupied ^= square_bb(first_square(Ours & Pos.pieces(Side, piece_name(n))));
+        Attackers = attackers_to(Pos, to, Occupied) & Occupied;
+        Attacker = piece_name(n);
+    }
+
+    while (--depth > 0)
+        Gain[depth - 1] = -max(-Gain[depth - 1], Gain[depth]);
+    return Gain[0];
+}
+
+// Упорядочивание списка по исходным клеткам сортировкой подсчетом и построение индекса
+void index_moves (move_list& List, move_index& Index)
+{
+    chess_move Sorted[MaxMoves];
+    uint8_t Next[64];
+    int i, sq;
+
+    for (sq = 0; sq <= 64; sq++)
+        Index.First[sq] = 0;
+
+    for (i = 0; i < List.Count; i++)
+        Index.First[move_from(List.Moves[i]) + 1]++;
+
+    for (sq = 0; sq < 64; sq++){
+        Index.First[sq + 1] += Index.First[sq];
+        Next[sq] = Index.First[sq];
+    }
+
+    for (i = 0; i < List.Count; i++)
+        Sorted[Next[move_from(List.Moves[i])]++] = List.Moves[i];
+
+    for (i = 0; i < List.Count; i++)
+        List.Moves[i] = Sorted[i];
+}
+
+// Поиск хода по исходной и конечной клеткам. Просматриваются только ходы одной фигуры
+chess_move find_move (const move_list& List, const move_index& Index, int from, int to, piece_name Promotion)
+{
+    for (int i = Index.First[from]; i < Index.First[from + 1]; i++){
+        chess_move m = List.Moves[i];
+
+        if (move_to(m) == to && (!is_promotion(m) || promotion_piece(m) == Promotion))
+            return m;
+    }
+    return NoMove;
+}
+
+// Поиск хода, записанного строкой вида "e2e4" или "e7e8q"
+chess_move string_to_move (const move_list& List, const move_index& Index, const char* str)
+{
+    piece_name Promotion = Queen;
+
+    if (str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8')
+        return NoMove;
+    if (str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8')
+        return NoMove;
+
+    switch (str[4]){
+        case '\0': break;
+        case 'n': case 'N': Promotion = Knight; break;
+        case 'b': case 'B': Promotion = Bishop; break;
+        case 'r': case 'R': Promotion = Rook; break;
+        case 'q': case 'Q': Promotion = Queen; break;
+        default: return NoMove;
+    }
+
+    return find_move(List, Index, make_square(str[0] - 'a', str[1] - '1'), make_square(str[2] - 'a', str[3] - '1'), Promotion);
+}
+
+// Подсчет количества позиций, достижимых из данной ровно за depth полуходов
+// На последнем полуходе позиции не перебираются, а учитывается только количество ходов
+uint64_t perft (position& Pos, int depth)
+{
+    move_list List;
+    uint64_t Nodes = 0;
+    undo Undo;
+
+    if (depth == 0)
+        return 1;
+
+    generate_moves(Pos, List);
+
+    if (depth == 1)
+        return List.Count;
+
+    for (int i = 0; i < List.Count; i++){
+        make_move(Pos, List.Moves[i], Undo);
+        Nodes += perft(Pos, depth - 1);
+        unmake_move(Pos, List.Moves[i], Undo);
+    }
+    return Nodes;
+}
@@ -0,0 +1,48 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "Position.h"
+
+const int MaxMoves = 256; // В любой позиции легальных ходов меньше
+
+// Список ходов фиксированного размера
+struct move_list {
+    chess_move Moves[MaxMoves];
+    int Count = 0;
+
+    void add (chess_move m) {Moves[Count++] = m;}
+};
+
+// Индекс списка ходов по исходной клетке
+// Ходы с клетки sq занимают в списке места с First[sq] по First[sq + 1] - 1
+struct move_index {
+    uint8_t First[65];
+};
+
+// Построение списка всех легальных ходов текущего игрока
+void generate_moves (const position& Pos, move_list& List);
+
+// Построение списка легальных взятий текущего игрока
+void generate_captures (const position& Pos, move_list& List);
+
+// Оценка размена на клетке, куда делается ход m (static exchange evaluation), в сотых долях пешки
+// Стороны по очереди бьют на клетке самой дешевой фигурой и могут в любой момент прекратить размен
+// Связки не учитываются. Положительное значение - размен выгоден стороне, делающей ход
+int see (const position& Pos, chess_move m);
+
+// Упорядочивание списка по исходным клеткам и построение индекса
+void index_moves (move_list& List, move_index& Index);
+
+// Поиск хода с клетки from на клетку to в индексированном списке, NoMove если такого хода нет
+// Если ход - превращение пешки, выбирается превращение в фигуру Promotion
+chess_move find_move (const move_list& List, const move_index& Index, int from, int to, piece_name Promotion = Queen);
+
+// Поиск в индексированном списке хода, записанного строкой вида "e2e4" или "e7e8q" (без буквы - превращение в ферзя),
+// NoMove если ход неправильный
+chess_move string_to_move (const move_list& List, const move_index& Index, const char* str);
+
+// Подсчет количества позиций, достижимых из данной ровно за depth полуходов (perft)
+// Дерево перебирается ходами и их отменой, по завершении позиция остается прежней
+uint64_t perft (position& Pos, int depth);
+
+#endif
@@ -0,0 +1,149 @@
+#include <cstring>
+#include "Notation.h"
+
+using namespace std;
+
+// Буквы фигур в SAN, пешка буквы не имеет
+static const char PieceLetters[] = "PNBRQK";
+
+// Запись хода в SAN
+void move_to_SAN (const position& Pos, chess_move m, char* str)
+{
+    int from = move_from(m);
+    int to = move_to(m);
+    piece_name n = Pos.piece_on(from);
+    bool Takes = is_capture(m);
+
+    if (move_flags(m) == ShortCastle || move_flags(m) == LongCastle){
+        strcpy(str, move_flags(m) == ShortCastle ? "O-O" : "O-O-O");
+        str += strlen(str);
+    }
+    else{
+        if (n != Pawn){
+            move_list List;
+            bool Ambiguous = false, SameFile = false, SameRank = false;
+
+            *str++ = PieceLetters[n];
+
+            // Если на ту же клетку может пойти другая такая же фигура, указывается вертикаль,
+            // горизонталь или обе координаты исходной клетки
+            generate_moves(Pos, List);
+            for (int i = 0; i < List.Count; i++){
+                int other = move_from(List.Moves[i]);
+
+                if (other == from || move_to(List.Moves[i]) != to || Pos.piece_on(other) != n)
+                    continue;
+                Ambiguous = true;
+                SameFile |= square_hor(other) == square_hor(from);
+                SameRank |= square_vert(other) == square_vert(from);
+            }
+
+            if (Ambiguous && (!SameFile || SameRank))
+                *str++ = char('a' + square_hor(from));
+            if (Ambiguous && SameFile)
+                *str++ = char('1' + square_vert(from));
+        }
+        else if (Takes)
+            *str++ = char('a' + square_hor(from));
+
+        if (Takes)
+            *str++ = 'x';
+        *str++ = char('a' + square_hor(to));
+        *str++ = char('1' + square_vert(to));
+
+        if (is_promotion(m)){
+            *str++ = '=';
+            *str++ = PieceLetters[promotion_piece(m)];
+        }
+    }
+
+    // Шах или мат после хода
+    position After = Pos;
+    make_move(After, m);
+    if (in_check(After)){
+        move_list Replies;
+        generate_moves(After, Replies);
+        *str++ = Replies.Count ? '+' : '#';
+    }
+    *str = '\0';
+}
+
+// Поиск хода, записанного в SAN
+// Из записи извлекаются фигура, клетка назначения и уточнения исходной клетки, после чего ход ищется
+// среди легальных: подходящий ход должен быть ровно один
+chess_move SAN_to_move (const position& Pos, const char* str)
+{
+    char s[SANSize];
+    int Length = 0;
+    move_list List;
+
+    for (; *str && Length < SANSize - 1; str++)
+        if (!strchr("+#!?", *str))
+            s[Length++] = *str;
+    s[Length] = '\0';
+
+    generate_moves(Pos, List);
+
+    // Рокировки, в том числе записанные через ноль
+    bool Short = !strcmp(s, "O-O") || !strcmp(s, "0-0");
+    bool Long = !strcmp(s, "O-O-O") || !strcmp(s, "0-0-0");
+    if (Short || Long){
+        for (int i = 0; i < List.Count; i++)
+            if (move_flags(List.Moves[i]) == (Short ? ShortCastle : LongCastle))
+                return List.Moves[i];
+        return NoMove;
+    }
+
+    piece_name n = Pawn;
+    piece_name Promotion = NoName;
+    int First = 0;
+    const char* p;
+
+    if (s[0] && s[0] != 'P' && (p = strchr(PieceLetters, s[0]))){
+        n = piece_name(p - PieceLetters);
+        First = 1;
+    }
+
+    // Превращение пешки записывается буквой фигуры после клетки, обычно через знак "="
+    // Без буквы пешка превращается в ферзя, как и при вводе хода координатами
+    if (n == Pawn && Length >= 3 && strchr("NBRQ", s[Length - 1])){
+        Promotion = piece_name(strchr(PieceLetters, s[Length - 1]) - PieceLetters);
+        Length -= s[Length - 2] == '=' ? 2 : 1;
+    }
+
+    if (Length - First < 2)
+        return NoMove;
+
+    char h = s[Length - 2], v = s[Length - 1];
+    if (h < 'a' || h > 'h' || v < '1' || v > '8')
+        return NoMove;
+    int to = make_square(h - 'a', v - '1');
+
+    // Уточнения исходной клетки между буквой фигуры и клеткой назначения
+    int FromHor = -1, FromVert = -1;
+    for (int i = First; i < Length - 2; i++){
+        if (s[i] >= 'a' && s[i] <= 'h')
+            FromHor = s[i] - 'a';
+        else if (s[i] >= '1' && s[i] <= '8')
+            FromVert = s[i] - '1';
+        else if (s[i] != 'x' && s[i] != ':')
+            return NoMove;
+    }
+
+    chess_move Found = NoMove;
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = List.Moves[i];
+        int from = move_from(m);
+
+        if (move_to(m) != to || Pos.piece_on(from) != n)
+            continue;
+        if (is_promotion(m) ? promotion_piece(m) != (Promotion != NoName ? Promotion : Queen) : Promotion != NoName)
+            continue;
+        if ((FromHor >= 0 && square_hor(from) != FromHor) || (FromVert >= 0 && square_vert(from) != FromVert))
+            continue;
+        if (Found != NoMove)
+            return NoMove;
+        Found = m;
+    }
+    return Found;
+}
@@ -0,0 +1,17 @@
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include "Movegen.h"
+
+// Длина буфера, достаточная для записи любого хода в алгебраической нотации
+const int SANSize = 10;
+
+// Запись легального хода в стандартной алгебраической нотации (SAN), например "Nbd7", "exd5", "O-O", "Qh4+"
+void move_to_SAN (const position& Pos, chess_move m, char* str);
+
+// Поиск легального хода, записанного в SAN. Символы шаха, мата и оценки хода ("+", "#", "!", "?") не учитываются
+// Превращение без буквы фигуры ("a8") считается превращением в ферзя
+// Возвращает NoMove, если запись неправильная, неоднозначная или ход невозможен
+chess_move SAN_to_move (const position& Pos, const char* str);
+
+#endif
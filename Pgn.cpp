@@ -0,0 +1,238 @@
+#include <cstring>
+#include <ctime>
+#include "Pgn.h"
+
+using namespace std;
+
+// Наибольшая длина строки ходов в файле PGN
+const int PGNLineLength = 80;
+
+// Запись партии в формате PGN
+void write_PGN (FILE* File, const pgn_game& Game)
+{
+    position Pos;
+    char SAN[SANSize];
+    char Token[SANSize + 16];
+    time_t Now = time(0);
+    tm* Date = localtime(&Now);
+
+    load_FEN(Pos, Game.FEN[0] ? Game.FEN : StartPositionFEN);
+
+    fprintf(File, "[Event \"?\"]\n[Site \"?\"]\n[Date \"%04d.%02d.%02d\"]\n[Round \"?\"]\n",
+            Date->tm_year + 1900, Date->tm_mon + 1, Date->tm_mday);
+    fprintf(File, "[White \"?\"]\n[Black \"?\"]\n[Result \"%s\"]\n", Game.Result);
+    if (Game.FEN[0])
+        fprintf(File, "[SetUp \"1\"]\n[FEN \"%s\"]\n", Game.FEN);
+    fputc('\n', File);
+
+    // Номер хода пишется перед ходом белых, а также перед первым ходом, если партию начинают черные
+    int LineLength = 0;
+    for (size_t i = 0; i <= Game.Moves.size(); i++){
+        if (i == Game.Moves.size())
+            strcpy(Token, Game.Result);
+        else{
+            move_to_SAN(Pos, Game.Moves[i], SAN);
+            if (Pos.CurrentColour == White)
+                sprintf(Token, "%d. %s", Pos.FullMove, SAN);
+            else if (i == 0)
+                sprintf(Token, "%d... %s", Pos.FullMove, SAN);
+            else
+                strcpy(Token, SAN);
+            make_move(Pos, Game.Moves[i]);
+        }
+
+        int TokenLength = int(strlen(Token));
+        if (LineLength > 0 && LineLength + 1 + TokenLength > PGNLineLength){
+            fputc('\n', File);
+            LineLength = 0;
+        }
+        if (LineLength > 0){
+            fputc(' ', File);
+            LineLength++;
+        }
+        fputs(Token, File);
+        LineLength += TokenLength;
+    }
+    fputs("\n\n", File);
+}
+
+// Следующий символ без извлечения. Буфер пополняется, когда прочитан до конца
+int pgn_reader :: peek_char ()
+{
+    if (Offset == Length){
+        Length = int(fread(Buffer, 1, sizeof(Buffer), File));
+        Offset = 0;
+        if (Length == 0)
+            return EOF;
+    }
+    return (unsigned char) Buffer[Offset];
+}
+
+int pgn_reader :: get_char ()
+{
+    int c = peek_char();
+
+    if (c != EOF)
+        Offset++;
+    if (c == '\n')
+        Line++;
+    return c;
+}
+
+void pgn_reader :: skip_until (int End)
+{
+    for (int c = get_char(); c != End && c != EOF; c = get_char());
+}
+
+// Варианты могут быть вложенными, а комментарии внутри них - содержать скобки
+void pgn_reader :: skip_variation ()
+{
+    int Depth = 1;
+
+    while (Depth > 0){
+        int c = get_char();
+
+        if (c == EOF)
+            return;
+        if (c == '(')
+            Depth++;
+        else if (c == ')')
+            Depth--;
+        else if (c == '{')
+            skip_until('}');
+        else if (c == ';')
+            skip_until('\n');
+    }
+}
+
+// Разбор тега. Учитываются только теги FEN и Result, остальные пропускаются
+bool pgn_reader :: read_tag (pgn_game& Game, position& Pos)
+{
+    char Name[32], Value[256];
+    int NameLength = 0, ValueLength = 0;
+    int c;
+
+    for (c = get_char(); c == ' ' || c == '\t'; c = get_char());
+    for (; c != EOF && c != ' ' && c != '\t' && c != '"' && c != ']'; c = get_char())
+        if (NameLength < int(sizeof(Name)) - 1)
+            Name[NameLength++] = char(c);
+    Name[NameLength] = '\0';
+
+    for (; c == ' ' || c == '\t'; c = get_char());
+    if (c == '"'){
+        // Внутри значения кавычка и обратная косая черта экранируются обратной косой чертой
+        for (c = get_char(); c != EOF && c != '"' && c != '\n'; c = get_char()){
+            if (c == '\\')
+                c = get_char();
+            if (c != EOF && ValueLength < int(sizeof(Value)) - 1)
+                Value[ValueLength++] = char(c);
+        }
+    }
+    Value[ValueLength] = '\0';
+    if (c != ']')
+        skip_until(']');
+
+    if (!strcmp(Name, "Result") && ValueLength < ResultSize)
+        strcpy(Game.Result, Value);
+
+    if (!strcmp(Name, "FEN")){
+        if (ValueLength >= FENSize || !load_FEN(Pos, Value))
+            return false;
+        strcpy(Game.FEN, Value);
+    }
+    return true;
+}
+
+// Конец лексемы в тексте ходов
+static inline bool token_end (int c)
+{
+    return c == EOF || c == ' ' || c == '\t' || c == '\r' || c == '\n' || strchr("{}()[];$", c);
+}
+
+// Чтение партии: теги, затем ходы до обозначения результата
+// Следующая партия может начаться и без результата в конце предыдущей, тогда ее признак - новый тег после ходов
+bool pgn_reader :: read_game (pgn_game& Game)
+{
+    position Pos;
+    char Token[64];
+    bool Started = false, InMoves = false;
+
+    load_FEN(Pos, StartPositionFEN);
+    Game.FEN[0] = '\0';
+    Game.Moves.clear();
+    strcpy(Game.Result, "*");
+    Game.ErrorLine = 0;
+
+    for (;;){
+        int c = peek_char();
+
+        if (c == EOF)
+            return Started;
+
+        if (c == '[' && InMoves)
+            return true;
+
+        get_char();
+        switch (c){
+            case ' ': case '\t': case '\r': case '\n':
+                continue;
+            case '[':
+                Started = true;
+                if (!read_tag(Game, Pos) && !Game.ErrorLine)
+                    Game.ErrorLine = Line;
+                continue;
+            case '{':
+                skip_until('}');
+                continue;
+            case ';':
+                skip_until('\n');
+                continue;
+            case '(':
+                skip_variation();
+                continue;
+            case ')': case '}': case ']': // Непарные скобки
+                continue;
+            case '$': // Числовая оценка хода
+                while (peek_char() >= '0' && peek_char() <= '9')
+                    get_char();
+                continue;
+        }
+
+        int TokenLength = 0;
+        Token[TokenLength++] = char(c);
+        while (!token_end(peek_char())){
+            c = get_char();
+            if (TokenLength < int(sizeof(Token)) - 1)
+                Token[TokenLength++] = char(c);
+        }
+        Token[TokenLength] = '\0';
+        Started = InMoves = true;
+
+        if (!strcmp(Token, "1-0") || !strcmp(Token, "0-1") || !strcmp(Token, "1/2-1/2") || !strcmp(Token, "*")){
+            strcpy(Game.Result, Token);
+            return true;
+        }
+
+        // Номер хода может стоять вплотную к ходу: "12.e4", "12...Nf6"
+        char* Move = Token;
+        if (*Move >= '1' && *Move <= '9' && strchr(Token, '.')){
+            while (*Move >= '0' && *Move <= '9')
+                Move++;
+            while (*Move == '.')
+                Move++;
+            if (!*Move)
+                continue;
+        }
+
+        if (Game.ErrorLine)
+            continue;
+
+        chess_move m = SAN_to_move(Pos, Move);
+        if (m == NoMove){
+            Game.ErrorLine = Line;
+            continue;
+        }
+        Game.Moves.push_back(m);
+        make_move(Pos, m);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdio>
+#include <vector>
+#include "Notation.h"
+
+// Длина буфера для результата партии: "1-0", "0-1", "1/2-1/2" или "*"
+const int ResultSize = 8;
+
+// Запись партии: начальная позиция, сделанные ходы и результат
+struct pgn_game {
+    char FEN[FENSize] = ""; // Начальная позиция, пустая строка - обычная начальная расстановка
+    std::vector<chess_move> Moves; // Ходы партии по порядку
+    char Result[ResultSize] = "*";
+    int ErrorLine = 0; // Строка файла с неправильным ходом или позицией при чтении, 0 если ошибок нет
+};
+
+// Запись партии в формате PGN: семь обязательных тегов, при нестандартной начальной позиции - теги SetUp и FEN,
+// затем ходы в SAN с номерами ходов, строки не длиннее 80 символов
+void write_PGN (FILE* File, const pgn_game& Game);
+
+// Потоковое чтение партий из файла PGN
+// Файл читается блоками в собственный буфер, ходы каждой партии сразу проверяются и выполняются на доске,
+// поэтому большие базы партий обрабатываются без загрузки в память целиком
+class pgn_reader {
+    FILE* File;
+    char Buffer[1 << 16];
+    int Length = 0; // Количество прочитанных в буфер символов
+    int Offset = 0; // Номер следующего символа в буфере
+    int Line = 1; // Номер текущей строки файла
+
+    int peek_char (); // Следующий символ без его извлечения, EOF в конце файла
+    int get_char ();
+    void skip_until (int End); // Пропуск символов до End включительно
+    void skip_variation (); // Пропуск варианта в скобках вместе с вложенными вариантами и комментариями
+    bool read_tag (pgn_game& Game, position& Pos); // Разбор тега [Name "Value"], false при ошибке в теге FEN
+
+  public:
+    explicit pgn_reader (FILE* f) : File(f) {}
+
+    // Чтение следующей партии. Возвращает false, если партий в файле больше нет
+    // Если ход или начальная позиция неправильные, в Game.ErrorLine записывается номер строки,
+    // а остальные ходы партии пропускаются
+    bool read_game (pgn_game& Game);
+};
+
+#endif
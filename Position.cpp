@@ -0,0 +1,655 @@
+#include <cstring>
+#include "Position.h"
+#include "Stats.h"
+
+using namespace std;
+
+uint64_t ZobristPieces[2][6][64];
+uint64_t ZobristCastle[16];
+uint64_t ZobristEp[8];
+uint64_t ZobristSide;
+
+score PSQ[2][6][64];
+
+// Генератор псевдослучайных чисел xorshift64* с постоянным начальным значением,
+// чтобы ключи одной и той же позиции совпадали при разных запусках программы
+static uint64_t random64 ()
+{
+    static uint64_t State = 0x9E3779B97F4A7C15ULL;
+
+    State ^= State >> 12;
+    State ^= State << 25;
+    State ^= State >> 27;
+    return State * 0x2545F4914F6CDD1DULL;
+}
+
+// Заполнение таблиц Зобриста
+void init_zobrist ()
+{
+    for (int c = White; c <= Black; c++)
+        for (int n = Pawn; n < NoName; n++)
+            for (int sq = 0; sq < 64; sq++)
+                ZobristPieces[c][n][sq] = random64();
+
+    for (int i = 0; i < 16; i++)
+        ZobristCastle[i] = random64();
+
+    for (int i = 0; i < 8; i++)
+        ZobristEp[i] = random64();
+
+    ZobristSide = random64();
+}
+
+// Вычисление хеш-ключа позиции полным перебором фигур
+uint64_t compute_key (const position& Pos)
+{
+    uint64_t Key = ZobristCastle[Pos.CastleRights];
+
+    for (int c = White; c <= Black; c++)
+        for (int n = Pawn; n < NoName; n++)
+            for (bitboard b = Pos.Pieces[c][n]; b; )
+                Key ^= ZobristPieces[c][n][pop_first(b)];
+
+    if (Pos.EpSquare != NoSquare)
+        Key ^= ZobristEp[square_hor(Pos.EpSquare)];
+    if (Pos.CurrentColour == Black)
+        Key ^= ZobristSide;
+    return Key;
+}
+
+// Вычисление хеш-ключа пешек, используются те же числа, что и для полного ключа
+uint64_t compute_pawn_key (const position& Pos)
+{
+    uint64_t Key = 0;
+
+    for (int c = White; c <= Black; c++)
+        for (bitboard b = Pos.Pieces[c][Pawn]; b; )
+            Key ^= ZobristPieces[c][Pawn][pop_first(b)];
+    return Key;
+}
+
+// Очистка доски
+void position :: clear ()
+{
+    memset(Pieces, 0, sizeof(Pieces));
+    memset(Colours, 0, sizeof(Colours));
+    Occupied = 0;
+    memset(Board, NoPiece, sizeof(Board));
+    CurrentColour = White;
+    CastleRights = 0;
+    EpSquare = NoSquare;
+    Rule50 = 0;
+    FullMove = 1;
+    Key = 0;
+    PawnKey = 0;
+    PSQScore = 0;
+    Phase = 0;
+}
+
+void position :: put_piece (piece_colour c, piece_name n, int sq)
+{
+    bitboard b = square_bb(sq);
+
+    Pieces[c][n] |= b;
+    Colours[c] |= b;
+    Occupied |= b;
+    Board[sq] = piece_code(c, n);
+    PSQScore += PSQ[c][n][sq];
+    Phase += PhaseWeight[n];
+}
+
+void position :: remove_piece (piece_colour c, piece_name n, int sq)
+{
+    bitboard b = square_bb(sq);
+
+    Pieces[c][n] ^= b;
+    Colours[c] ^= b;
+    Occupied ^= b;
+    Board[sq] = NoPiece;
+    PSQScore -= PSQ[c][n][sq];
+    Phase -= PhaseWeight[n];
+}
+
+void position :: move_piece (piece_colour c, piece_name n, int from, int to)
+{
+    bitboard b = square_bb(from) | square_bb(to);
+
+    Pieces[c][n] ^= b;
+    Colours[c] ^= b;
+    Occupied ^= b;
+    Board[from] = NoPiece;
+    Board[to] = piece_code(c, n);
+    PSQScore += PSQ[c][n][to] - PSQ[c][n][from];
+}
+
+// Проверка, атакована ли клетка фигурами цвета by
+// Атаки считаются "от клетки": например, клетку атакует конь by, если конь с этой клетки попал бы на него
+bool square_attacked (const position& Pos, int sq, piece_colour by)
+{
+    STAT_COUNT(StatSquareAttacked);
+
+    if (pawn_attacks(opposite(by), sq) & Pos.pieces(by, Pawn))
+        return true;
+    if (knight_attacks(sq) & Pos.pieces(by, Knight))
+        return true;
+    if (king_attacks(sq) & Pos.pieces(by, King))
+        return true;
+    if (bishop_attacks(sq, Pos.Occupied) & (Pos.pieces(by, Bishop) | Pos.pieces(by, Queen)))
+        return true;
+    if (rook_attacks(sq, Pos.Occupied) & (Pos.pieces(by, Rook) | Pos.pieces(by, Queen)))
+        return true;
+    return false;
+}
+
+// Маска всех фигур обоих цветов, атакующих клетку
+// Занятость передается отдельно, чтобы можно было проверить атаки "сквозь" снятую с доски фигуру
+bitboard attackers_to (const position& Pos, int sq, bitboard occupied)
+{
+    return (pawn_attacks(Black, sq) & Pos.pieces(White, Pawn))
+         | (pawn_attacks(White, sq) & Pos.pieces(Black, Pawn))
+         | (knight_attacks(sq) & (Pos.pieces(White, Knight) | Pos.pieces(Black, Knight)))
+         | (king_attacks(sq) & (Pos.pieces(White, King) | Pos.pieces(Black, King)))
+         | (bishop_attacks(sq, occupied) & (Pos.pieces(White, Bishop) | Pos.pieces(Black, Bishop)
+                                          | Pos.pieces(White, Queen) | Pos.pieces(Black, Queen)))
+         | (rook_attacks(sq, occupied) & (Pos.pieces(White, Rook) | Pos.pieces(Black, Rook)
+                                        | Pos.pieces(White, Queen) | Pos.pieces(Black, Queen)));
+}
+
+// Маска рокировок, сохраняющихся после хода с клетки или на клетку
+// Ход короля или ладьи, а также взятие ладьи на исходной клетке отменяют соответствующие рокировки
+static inline int castle_mask (int sq)
+{
+    switch (sq){
+        case 0: return ~WhiteLongCastle; // a1
+        case 4: return ~(WhiteShortCastle | WhiteLongCastle); // e1
+        case 7: return ~WhiteShortCastle; // h1
+        case 56: return ~BlackLongCastle; // a8
+        case 60: return ~(BlackShortCastle | BlackLongCastle); // e8
+        case 63: return ~BlackShortCastle; // h8
+    }
+    return ~0;
+}
+
+// Осуществление хода
+// Хеш-ключ обновляется по изменившимся клеткам, рокировкам, полю взятия на проходе и цвету ходящего игрока
+void make_move (position& Pos, chess_move m, undo& Undo)
+{
+    int from = move_from(m);
+    int to = move_to(m);
+    int flags = move_flags(m);
+    piece_colour Us = Pos.CurrentColour;
+    piece_colour Them = opposite(Us);
+    piece_name Moved = Pos.piece_on(from);
+    piece_name Captured = is_capture(m) ? (flags == EnPassant ? Pawn : Pos.piece_on(to)) : NoName;
+
+    STAT_COUNT(StatMakeMove);
+
+    Undo.Moved = Moved;
+    Undo.Captured = Captured;
+    Undo.CastleRights = Pos.CastleRights;
+    Undo.EpSquare = Pos.EpSquare;
+    Undo.Rule50 = Pos.Rule50;
+    Undo.Key = Pos.Key;
+    Undo.PawnKey = Pos.PawnKey;
+
+    Pos.Rule50 = (Moved == Pawn || Captured != NoName) ? 0 : Pos.Rule50 + 1;
+    if (Us == Black)
+        Pos.FullMove++;
+
+    if (Pos.EpSquare != NoSquare){
+        Pos.Key ^= ZobristEp[square_hor(Pos.EpSquare)];
+        Pos.EpSquare = NoSquare;
+    }
+
+    if (Captured != NoName){
+        // Пешка, взятая на проходе, стоит не на конечной клетке, а рядом с ней
+        int CaptureSquare = flags == EnPassant ? (Us == White ? to - 8 : to + 8) : to;
+
+        Pos.remove_piece(Them, Captured, CaptureSquare);
+        Pos.Key ^= ZobristPieces[Them][Captured][CaptureSquare];
+        if (Captured == Pawn)
+            Pos.PawnKey ^= ZobristPieces[Them][Pawn][CaptureSquare];
+    }
+
+    Pos.move_piece(Us, Moved, from, to);
+    Pos.Key ^= ZobristPieces[Us][Moved][from] ^ ZobristPieces[Us][Moved][to];
+    if (Moved == Pawn)
+        Pos.PawnKey ^= ZobristPieces[Us][Pawn][from] ^ ZobristPieces[Us][Pawn][to];
+
+    // Превращение: дошедшая пешка заменяется выбранной фигурой
+    if (is_promotion(m)){
+        piece_name n = promotion_piece(m);
+
+        Pos.remove_piece(Us, Pawn, to);
+        Pos.put_piece(Us, n, to);
+        Pos.Key ^= ZobristPieces[Us][Pawn][to] ^ ZobristPieces[Us][n][to];
+        Pos.PawnKey ^= ZobristPieces[Us][Pawn][to];
+    }
+
+    // Поле взятия на проходе запоминается, только если рядом есть пешка, которая может им воспользоваться,
+    // иначе одинаковые позиции получали бы разные ключи и повторения не обнаруживались бы
+    if (flags == DoublePush && (pawn_attacks(Us, (from + to) / 2) & Pos.pieces(Them, Pawn))){
+        Pos.EpSquare = (from + to) / 2;
+        Pos.Key ^= ZobristEp[square_hor(Pos.EpSquare)];
+    }
+
+    // При рокировке вместе с королем перемещается ладья
+    if (flags == ShortCastle){
+        Pos.move_piece(Us, Rook, to + 1, to - 1);
+        Pos.Key ^= ZobristPieces[Us][Rook][to + 1] ^ ZobristPieces[Us][Rook][to - 1];
+    }
+    if (flags == LongCastle){
+        Pos.move_piece(Us, Rook, to - 2, to + 1);
+        Pos.Key ^= ZobristPieces[Us][Rook][to - 2] ^ ZobristPieces[Us][Rook][to + 1];
+    }
+
+    Pos.Key ^= ZobristCastle[Pos.CastleRights];
+    Pos.CastleRights &= castle_mask(from) & castle_mask(to);
+    Pos.Key ^= ZobristCastle[Pos.CastleRights];
+
+    Pos.CurrentColour = Them;
+    Pos.Key ^= ZobristSide;
+}
+
+// Отмена хода: действия make_move() выполняются в обратном порядке
+void unmake_move (position& Pos, chess_move m, const undo& Undo)
+{
+    int from = move_from(m);
+    int to = move_to(m);
+    int flags = move_flags(m);
+    piece_colour Us = opposite(Pos.CurrentColour);
+
+    Pos.CurrentColour = Us;
+    Pos.CastleRights = Undo.CastleRights;
+    Pos.EpSquare = Undo.EpSquare;
+    Pos.Rule50 = Undo.Rule50;
+    Pos.Key = Undo.Key;
+    Pos.PawnKey = Undo.PawnKey;
+    if (Us == Black)
+        Pos.FullMove--;
+
+    if (flags == ShortCastle)
+        Pos.move_piece(Us, Rook, to - 1, to + 1);
+    if (flags == LongCastle)
+        Pos.move_piece(Us, Rook, to + 1, to - 2);
+
+    if (is_promotion(m)){
+        Pos.remove_piece(Us, promotion_piece(m), to);
+        Pos.put_piece(Us, Pawn, from);
+    }
+    else
+        Pos.move_piece(Us, piece_name(Undo.Moved), to, from);
+
+    if (Undo.Captured != NoName)
+        Pos.put_piece(opposite(Us), piece_name(Undo.Captured), flags == EnPassant ? (Us == White ? to - 8 : to + 8) : to);
+}
+
+// Проверка ничьей из-за недостатка материала: ни одна из сторон не может поставить мат
+// Это голые короли, король с одной легкой фигурой против короля и слоны только одного цвета полей
+bool insufficient_material (const position& Pos)
+{
+    const bitboard DarkSquares = 0xAA55AA55AA55AA55ULL;
+    bitboard Bishops = Pos.pieces(White, Bishop) | Pos.pieces(Black, Bishop);
+    bitboard Knights = Pos.pieces(White, Knight) | Pos.pieces(Black, Knight);
+
+    if (Pos.pieces(White, Pawn) | Pos.pieces(Black, Pawn) | Pos.pieces(White, Rook) | Pos.pieces(Black, Rook)
+        | Pos.pieces(White, Queen) | Pos.pieces(Black, Queen))
+        return false;
+
+    if (pop_count(Bishops | Knights) <= 1)
+        return true;
+
+    return !Knights && (!(Bishops & DarkSquares) || !(Bishops & ~DarkSquares));
+}
+
+// Количество повторений позиции среди предыдущих позиций партии
+// Повториться могут только позиции с тем же ходящим игроком после последнего необратимого хода
+int key_history :: repetitions (const position& Pos) const
+{
+    int Count = 0;
+
+    for (int i = 2; i <= Pos.Rule50 && i <= Size; i += 2)
+        if (Keys[Size - i] == Pos.Key)
+            Count++;
+    return Count;
+}
+
+// Запись хода в строку в формате "e2e4", при превращении добавляется буква фигуры: "e7e8q"
+void move_to_string (chess_move m, char* str)
+{
+    str[0] = 'a' + char(square_hor(move_from(m)));
+    str[1] = '1' + char(square_vert(move_from(m)));
+    str[2] = 'a' + char(square_hor(move_to(m)));
+    str[3] = '1' + char(square_vert(move_to(m)));
+    str[4] = is_promotion(m) ? "pnbrqk"[promotion_piece(m)] : '\0';
+    str[5] = '\0';
+}
+
+// Символы фигур в нотации FEN: номер символа равен Colour * 6 + Name
+static const char PieceSymbols[] = "PNBRQKpnbrqk";
+
+// Считывание клетки вида "e3", NoSquare при ошибке
+static int read_square (const char* sym)
+{
+    if (sym[0] < 'a' || sym[0] > 'h' || sym[1] < '1' || sym[1] > '8')
+        return NoSquare;
+    return make_square(sym[0] - 'a', sym[1] - '1');
+}
+
+// Считывание неотрицательного числа с переводом указателя за его конец, -1 при ошибке
+static int read_number (const char*& sym)
+{
+    int n = 0;
+
+    if (*sym < '0' || *sym > '9')
+        return -1;
+    for (; *sym >= '0' && *sym <= '9'; sym++)
+        if ((n = n * 10 + (*sym - '0')) > 65535)
+            return -1;
+    return n;
+}
+
+// Переход к следующему полю записи. Возвращает false, если полей больше нет
+static bool next_field (const char*& sym)
+{
+    for (; *sym == ' ' || *sym == '\t' || *sym == '\r' || *sym == '\n'; sym++);
+    return *sym != '\0';
+}
+
+// Конец поля: пробел или конец строки
+static inline bool field_end (char c)
+{
+    return c == '\0' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Проверка допустимости позиции, расставленной из FEN или упакованной записи, и вычисление ключей
+// Недоступные рокировки и невозможное взятие на проходе отбрасываются, остальные ошибки делают позицию недопустимой
+static bool finish_setup (position& Pos)
+{
+    // У каждой стороны ровно один король, пешек на крайних горизонталях нет
+    if (pop_count(Pos.pieces(White, King)) != 1 || pop_count(Pos.pieces(Black, King)) != 1)
+        return false;
+    if ((Pos.pieces(White, Pawn) | Pos.pieces(Black, Pawn)) & (Rank1 | Rank8))
+        return false;
+
+    // У каждой стороны не больше 16 фигур, из них не больше 8 пешек
+    for (int c = White; c <= Black; c++)
+        if (pop_count(Pos.Colours[c]) > 16 || pop_count(Pos.pieces(piece_colour(c), Pawn)) > 8)
+            return false;
+
+    // Король игрока, который не ходит, не может находиться под шахом
+    if (square_attacked(Pos, Pos.king_square(opposite(Pos.CurrentColour)), Pos.CurrentColour))
+        return false;
+
+    // Рокировки, для которых король или ладья не стоят на исходных клетках, отбрасываются
+    if (!(Pos.pieces(White, King) & square_bb(4)))
+        Pos.CastleRights &= ~(WhiteShortCastle | WhiteLongCastle);
+    if (!(Pos.pieces(Black, King) & square_bb(60)))
+        Pos.CastleRights &= ~(BlackShortCastle | BlackLongCastle);
+    if (!(Pos.pieces(White, Rook) & square_bb(7)))
+        Pos.CastleRights &= ~WhiteShortCastle;
+    if (!(Pos.pieces(White, Rook) & square_bb(0)))
+        Pos.CastleRights &= ~WhiteLongCastle;
+    if (!(Pos.pieces(Black, Rook) & square_bb(63)))
+        Pos.CastleRights &= ~BlackShortCastle;
+    if (!(Pos.pieces(Black, Rook) & square_bb(56)))
+        Pos.CastleRights &= ~BlackLongCastle;
+
+    // За полем взятия на проходе должна стоять пешка, только что сходившая на две клетки
+    if (Pos.EpSquare != NoSquare){
+        int sq = Pos.EpSquare;
+        piece_colour Them = opposite(Pos.CurrentColour);
+        int PawnSquare = Them == White ? sq + 8 : sq - 8;
+
+        if (square_vert(sq) != (Them == White ? 2 : 5))
+            return false;
+        if (!(Pos.pieces(Them, Pawn) & square_bb(PawnSquare)) || (Pos.Occupied & square_bb(sq)))
+            return false;
+
+        // Как и в make_move(), поле запоминается, только если взятие на проходе возможно
+        if (!(pawn_attacks(Them, sq) & Pos.pieces(Pos.CurrentColour, Pawn)))
+            Pos.EpSquare = NoSquare;
+    }
+
+    Pos.Key = compute_key(Pos);
+    Pos.PawnKey = compute_pawn_key(Pos);
+    return true;
+}
+
+// Загрузка позиции в нотации FEN
+// Разбор идет прямо по строке без копирования и выделения памяти, чтобы можно было быстро загружать
+// позиции из больших файлов в одну и ту же структуру
+bool load_FEN (position& Pos, const char* sym)
+{
+    int hor = 0, vert = 7; // Расположение фигур считывается начиная с клетки а8
+
+    Pos.clear();
+
+    // Считывание положения фигур
+    for (next_field(sym); !field_end(*sym); ++sym){
+
+        // Обнаружение цифры и пропуск пустых клеток
+        if (*sym > '0' && *sym < '9'){
+            hor += *sym - '0';
+            if (hor > Gridsize)
+                return false;
+            continue;
+        }
+
+        // Переход на следующий ряд, в каждом ряду должно быть ровно 8 клеток
+        if (*sym == '/'){
+            if (hor != Gridsize || vert == 0)
+                return false;
+            hor = 0;
+            vert--;
+            continue;
+        }
+
+        const char* p = strchr(PieceSymbols, *sym);
+        if (!p || hor >= Gridsize)
+            return false;
+
+        // Лишние фигуры отбрасываются сразу: при большом их числе переполнилась бы сумма PSQ
+        if (pop_count(Pos.Colours[(p - PieceSymbols) / 6]) >= 16)
+            return false;
+
+        Pos.put_piece(piece_colour((p - PieceSymbols) / 6), piece_name((p - PieceSymbols) % 6), make_square(hor, vert));
+        hor++;
+    }
+
+    if (hor != Gridsize || vert != 0)
+        return false;
+
+    // Считывание активного цвета
+    if (!next_field(sym))
+        return false;
+    if (*sym == 'w')
+        Pos.CurrentColour = White;
+    else if (*sym == 'b')
+        Pos.CurrentColour = Black;
+    else
+        return false;
+    if (!field_end(*++sym))
+        return false;
+
+    // Считывание доступных рокировок
+    if (next_field(sym) && *sym == '-')
+        sym++;
+    else for (; !field_end(*sym); sym++){
+        switch (*sym){
+            case 'K': Pos.CastleRights |= WhiteShortCastle; break;
+            case 'Q': Pos.CastleRights |= WhiteLongCastle; break;
+            case 'k': Pos.CastleRights |= BlackShortCastle; break;
+            case 'q': Pos.CastleRights |= BlackLongCastle; break;
+            default: return false;
+        }
+    }
+    if (!field_end(*sym))
+        return false;
+
+    // Считывание поля взятия на проходе
+    if (next_field(sym) && *sym == '-')
+        sym++;
+    else if (*sym){
+        if ((Pos.EpSquare = read_square(sym)) == NoSquare)
+            return false;
+        sym += 2;
+    }
+    if (!field_end(*sym))
+        return false;
+
+    // Считывание счетчиков полуходов и ходов
+    if (next_field(sym) && (Pos.Rule50 = read_number(sym)) < 0)
+        return false;
+    if (next_field(sym) && (Pos.FullMove = read_number(sym)) < 0)
+        return false;
+    if (Pos.FullMove == 0)
+        Pos.FullMove = 1;
+
+    if (next_field(sym))
+        return false;
+
+    return finish_setup(Pos);
+}
+
+// Запись числа в строку с переводом указателя за его конец
+static void write_number (char*& str, int n)
+{
+    char Digits[12];
+    int Count = 0;
+
+    do
+        Digits[Count++] = char('0' + n % 10);
+    while (n /= 10);
+
+    while (Count)
+        *str++ = Digits[--Count];
+}
+
+// Запись позиции в нотации FEN
+void to_FEN (const position& Pos, char* str)
+{
+    for (int vert = 7; vert >= 0; vert--){
+        int Empty = 0;
+
+        for (int hor = 0; hor < Gridsize; hor++){
+            int sq = make_square(hor, vert);
+            piece_name n = Pos.piece_on(sq);
+
+            if (n == NoName){
+                Empty++;
+                continue;
+            }
+            if (Empty)
+                *str++ = char('0' + Empty);
+            Empty = 0;
+            *str++ = PieceSymbols[Pos.colour_on(sq) * 6 + n];
+        }
+
+        if (Empty)
+            *str++ = char('0' + Empty);
+        if (vert > 0)
+            *str++ = '/';
+    }
+
+    *str++ = ' ';
+    *str++ = Pos.CurrentColour == White ? 'w' : 'b';
+    *str++ = ' ';
+
+    if (!Pos.CastleRights)
+        *str++ = '-';
+    if (Pos.CastleRights & WhiteShortCastle)
+        *str++ = 'K';
+    if (Pos.CastleRights & WhiteLongCastle)
+        *str++ = 'Q';
+    if (Pos.CastleRights & BlackShortCastle)
+        *str++ = 'k';
+    if (Pos.CastleRights & BlackLongCastle)
+        *str++ = 'q';
+    *str++ = ' ';
+
+    if (Pos.EpSquare == NoSquare)
+        *str++ = '-';
+    else{
+        *str++ = char('a' + square_hor(Pos.EpSquare));
+        *str++ = char('1' + square_vert(Pos.EpSquare));
+    }
+    *str++ = ' ';
+
+    write_number(str, Pos.Rule50);
+    *str++ = ' ';
+    write_number(str, Pos.FullMove);
+    *str = '\0';
+}
+
+// Запись 16-битного числа в упакованную запись, младший байт первым
+static inline void write_uint16 (uint8_t* Bytes, int n)
+{
+    Bytes[0] = uint8_t(n);
+    Bytes[1] = uint8_t(n >> 8);
+}
+
+static inline int read_uint16 (const uint8_t* Bytes)
+{
+    return Bytes[0] | (Bytes[1] << 8);
+}
+
+// Упаковка позиции. Коды фигур берутся из массива клеток в порядке обхода маски занятых клеток
+bool pack_position (const position& Pos, packed_position& Packed)
+{
+    memset(&Packed, 0, sizeof(Packed));
+
+    if (pop_count(Pos.Occupied) > 32)
+        return false;
+
+    for (int i = 0; i < 8; i++)
+        Packed.Occupied[i] = uint8_t(Pos.Occupied >> (i * 8));
+
+    int Index = 0;
+    for (bitboard b = Pos.Occupied; b; Index++){
+        int sq = pop_first(b);
+
+        Packed.Pieces[Index / 2] |= uint8_t((Pos.colour_on(sq) * 6 + Pos.piece_on(sq)) << (Index % 2 * 4));
+    }
+
+    Packed.State = uint8_t(Pos.CurrentColour | (Pos.CastleRights << 1));
+    Packed.EpSquare = uint8_t(Pos.EpSquare);
+    write_uint16(Packed.Rule50, Pos.Rule50);
+    write_uint16(Packed.FullMove, Pos.FullMove);
+    return true;
+}
+
+// Распаковка позиции с теми же проверками, что и при загрузке FEN
+bool unpack_position (position& Pos, const packed_position& Packed)
+{
+    bitboard Occupied = 0;
+
+    Pos.clear();
+
+    for (int i = 0; i < 8; i++)
+        Occupied |= bitboard(Packed.Occupied[i]) << (i * 8);
+    if (pop_count(Occupied) > 32)
+        return false;
+
+    for (int Index = 0; Occupied; Index++){
+        int Code = (Packed.Pieces[Index / 2] >> (Index % 2 * 4)) & 15;
+
+        // Как и в load_FEN, у стороны не может быть больше 16 фигур
+        if (Code >= 12 || pop_count(Pos.Colours[Code / 6]) >= 16)
+            return false;
+        Pos.put_piece(piece_colour(Code / 6), piece_name(Code % 6), pop_first(Occupied));
+    }
+
+    if (Packed.State >> 5 || Packed.EpSquare > NoSquare || Packed.Reserved[0] || Packed.Reserved[1])
+        return false;
+
+    Pos.CurrentColour = piece_colour(Packed.State & 1);
+    Pos.CastleRights = Packed.State >> 1;
+    Pos.EpSquare = Packed.EpSquare;
+    Pos.Rule50 = read_uint16(Packed.Rule50);
+    Pos.FullMove = read_uint16(Packed.FullMove);
+    if (Pos.FullMove == 0)
+        Pos.FullMove = 1;
+
+    return finish_setup(Pos);
+}
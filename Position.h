@@ -0,0 +1,201 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <cstring>
+#include "Bitboard.h"
+
+// Флаги доступности рокировок
+enum castle_right {WhiteShortCastle = 1, WhiteLongCastle = 2, BlackShortCastle = 4, BlackLongCastle = 8};
+
+// Ход, упакованный в 16 бит: исходная клетка (6 бит), конечная клетка (6 бит), флаги (4 бита)
+typedef uint16_t chess_move;
+
+// Флаги хода. Бит Capture выставлен у всех взятий, бит Promotion - у превращений пешки,
+// младшие два бита превращения задают фигуру: 0 - конь, 1 - слон, 2 - ладья, 3 - ферзь
+enum move_flag {QuietMove, DoublePush, ShortCastle, LongCastle, Capture, EnPassant, Promotion = 8};
+
+const chess_move NoMove = 0; // Ход a1a1 невозможен и используется как пустое значение
+
+inline chess_move encode_move (int from, int to, int flags = QuietMove) {return chess_move(from | (to << 6) | (flags << 12));}
+inline int move_from (chess_move m) {return m & 63;}
+inline int move_to (chess_move m) {return (m >> 6) & 63;}
+inline int move_flags (chess_move m) {return m >> 12;}
+inline bool is_capture (chess_move m) {return move_flags(m) & Capture;}
+inline bool is_promotion (chess_move m) {return move_flags(m) & Promotion;}
+inline piece_name promotion_piece (chess_move m) {return piece_name(Knight + (move_flags(m) & 3));}
+
+// Оценка, упакованная в одно число: в младших 16 битах - значение для дебюта и миттельшпиля (mg),
+// в старших - для эндшпиля (eg). Складывать и вычитать упакованные оценки можно как обычные числа
+typedef int score;
+
+inline score make_score (int mg, int eg) {return score(int(unsigned(eg) << 16) + mg);}
+inline int mg_value (score s) {return int16_t(uint16_t(unsigned(s)));}
+inline int eg_value (score s) {return int16_t(uint16_t(unsigned(s + 0x8000) >> 16));}
+
+// Стоимость фигуры вместе с оценкой ее клетки, с точки зрения белых. Заполняется init_eval()
+extern score PSQ[2][6][64];
+
+// Вклад фигур в стадию игры: в начальной позиции стадия равна MaxPhase, без фигур - нулю
+const int PhaseWeight[6] = {0, 1, 1, 2, 4, 0};
+const int MaxPhase = 24;
+
+// Код фигуры в массиве клеток позиции: наименование в младших трех битах, цвет - в следующих
+// У пустой клетки наименование NoName и цвет NoColour, поэтому разбор кода не требует проверок
+inline uint8_t piece_code (piece_colour c, piece_name n) {return uint8_t(n | (c << 3));}
+const uint8_t NoPiece = NoName | (NoColour << 3);
+
+// Структура, хранящая позицию на доске в виде битбордов и массива клеток
+// Битборды нужны для генерации ходов и оценки, массив клеток - чтобы узнать фигуру на клетке за одно обращение
+struct position {
+    bitboard Pieces[2][6]; // Маски фигур по цвету и наименованию
+    bitboard Colours[2]; // Маски всех фигур каждого цвета
+    bitboard Occupied; // Маска всех занятых клеток
+    uint8_t Board[64]; // Коды фигур piece_code() по клеткам, NoPiece для пустых
+
+    piece_colour CurrentColour; // Цвет фигур игрока, делающего текущий ход
+    int CastleRights; // Доступные рокировки, комбинация флагов castle_right
+    int EpSquare; // Поле, через которое прошла пешка последним ходом на две клетки, иначе NoSquare
+    int Rule50; // Количество полуходов после последнего взятия или хода пешкой
+    int FullMove; // Номер хода, увеличивается после хода черных
+
+    uint64_t Key; // Хеш-ключ Зобриста, обновляется при каждом ходе
+    uint64_t PawnKey; // Хеш-ключ расположения пешек, по нему кэшируется оценка пешечной структуры
+
+    // Сумма PSQ всех фигур и стадия игры, обновляются при каждом изменении масок
+    score PSQScore;
+    int Phase;
+
+    position () {clear();}
+
+    void clear (); // Очистка доски
+
+    bitboard pieces (piece_colour c, piece_name n) const {return Pieces[c][n];}
+    piece_name piece_on (int sq) const {return piece_name(Board[sq] & 7);} // Наименование фигуры на клетке
+    piece_colour colour_on (int sq) const {return piece_colour(Board[sq] >> 3);} // Цвет фигуры на клетке
+    int king_square (piece_colour c) const {return first_square(Pieces[c][King]);}
+
+    // Изменение масок при постановке, снятии и перемещении фигуры
+    void put_piece (piece_colour c, piece_name n, int sq);
+    void remove_piece (piece_colour c, piece_name n, int sq);
+    void move_piece (piece_colour c, piece_name n, int from, int to);
+};
+
+// Случайные числа для вычисления хеш-ключа Зобриста
+// Ключ позиции - XOR чисел всех фигур на своих клетках, доступных рокировок, вертикали поля взятия
+// на проходе и цвета, если ходят черные
+extern uint64_t ZobristPieces[2][6][64];
+extern uint64_t ZobristCastle[16];
+extern uint64_t ZobristEp[8];
+extern uint64_t ZobristSide;
+
+// Заполнение таблиц Зобриста, вызывается один раз при запуске программы
+void init_zobrist ();
+
+// Вычисление хеш-ключа позиции полным перебором фигур
+uint64_t compute_key (const position& Pos);
+
+// Вычисление хеш-ключа расположения пешек обоих цветов
+uint64_t compute_pawn_key (const position& Pos);
+
+// Проверка, атакована ли клетка фигурами цвета by
+bool square_attacked (const position& Pos, int sq, piece_colour by);
+
+// Маска всех фигур обоих цветов, атакующих клетку при занятости доски occupied
+bitboard attackers_to (const position& Pos, int sq, bitboard occupied);
+
+// Проверка, находится ли король текущего игрока под шахом
+inline bool in_check (const position& Pos)
+{
+    return square_attacked(Pos, Pos.king_square(Pos.CurrentColour), opposite(Pos.CurrentColour));
+}
+
+// Данные, необходимые для отмены хода
+struct undo {
+    uint8_t Moved; // Наименование сходившей фигуры
+    uint8_t Captured; // Наименование взятой фигуры, NoName если взятия не было
+    uint8_t CastleRights; // Доступные рокировки до хода
+    uint8_t EpSquare; // Поле взятия на проходе до хода
+    uint16_t Rule50; // Счетчик полуходов до хода
+    uint64_t Key; // Хеш-ключ позиции до хода
+    uint64_t PawnKey; // Хеш-ключ пешек до хода
+};
+
+// Осуществление хода. Ход должен быть взят из списка, построенного generate_moves()
+// В Undo записываются данные, по которым unmake_move() восстанавливает позицию
+void make_move (position& Pos, chess_move m, undo& Undo);
+
+// Отмена хода, сделанного make_move() с тем же Undo
+void unmake_move (position& Pos, chess_move m, const undo& Undo);
+
+// Осуществление хода без возможности отмены
+inline void make_move (position& Pos, chess_move m)
+{
+    undo Undo;
+    make_move(Pos, m, Undo);
+}
+
+// Проверка ничьей из-за недостатка материала для мата у обеих сторон
+bool insufficient_material (const position& Pos);
+
+// История хеш-ключей позиций партии для обнаружения повторений. Хранится отдельно от позиции,
+// чтобы позицию можно было быстро копировать
+const int MaxHistory = 2048;
+
+struct key_history {
+    uint64_t Keys[MaxHistory]; // Ключи позиций перед каждым сделанным ходом
+    int Size = 0;
+
+    // В заполненной истории старшая половина ключей отбрасывается. Для повторений нужны только позиции
+    // после последнего взятия или хода пешкой, а pop() снимает ровно те ключи, что добавил push(),
+    // поэтому в партии любой длины добавление и снятие остаются согласованными
+    void push (uint64_t Key)
+    {
+        if (Size == MaxHistory){
+            memmove(Keys, Keys + MaxHistory / 2, sizeof(Keys) / 2);
+            Size = MaxHistory / 2;
+        }
+        Keys[Size++] = Key;
+    }
+    void pop () {if (Size > 0) Size--;}
+    int repetitions (const position& Pos) const; // Сколько раз позиция Pos уже встречалась
+};
+
+// Запись хода в строку в формате "e2e4" или "e7e8q", строка должна вмещать не менее 6 символов
+void move_to_string (chess_move m, char* str);
+
+// Длина буфера, достаточная для записи любой позиции в нотации FEN
+const int FENSize = 100;
+
+// Начальная расстановка фигур в нотации FEN
+const char StartPositionFEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Загрузка позиции в нотации FEN. Поля взятия на проходе и счетчиков ходов могут отсутствовать
+// Возвращает false, если строка не является записью допустимой позиции, содержимое Pos тогда не определено
+bool load_FEN (position& Pos, const char* sym);
+
+// Запись позиции в нотации FEN, строка должна вмещать не менее FENSize символов
+void to_FEN (const position& Pos, char* str);
+
+// Позиция, упакованная в 32 байта, для хранения больших наборов позиций и передачи по сети
+// Запись не зависит от порядка байтов процессора: многобайтовые числа хранятся младшим байтом вперед
+struct packed_position {
+    uint8_t Occupied[8]; // Маска занятых клеток
+    uint8_t Pieces[16]; // Коды фигур Colour * 6 + Name по полубайту, в порядке занятых клеток от a1 к h8
+    uint8_t State; // Бит 0 - цвет ходящего игрока, биты 1-4 - доступные рокировки
+    uint8_t EpSquare; // Поле взятия на проходе или NoSquare
+    uint8_t Rule50[2]; // Счетчик полуходов
+    uint8_t FullMove[2]; // Номер хода
+    uint8_t Reserved[2]; // Всегда нули
+};
+
+static_assert(sizeof(packed_position) == 32, "packed_position must take 32 bytes");
+
+// Упаковка позиции. Возвращает false, если на доске больше 32 фигур и позиция в запись не помещается
+// (после load_FEN и unpack_position такого не бывает)
+bool pack_position (const position& Pos, packed_position& Packed);
+
+// Распаковка позиции. Возвращает false, если запись не является допустимой позицией,
+// содержимое Pos тогда не определено
+bool unpack_position (position& Pos, const packed_position& Packed);
+
+#endif
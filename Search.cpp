@@ -0,0 +1,442 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <system_error>
+#include <vector>
+#include "Eval.h"
+#include "Search.h"
+#include "Stats.h"
+#include "TT.h"
+
+using namespace std;
+
+atomic<bool> StopSearch(false);
+
+// Пешечные таблицы потоков поиска сохраняются между поисками, чтобы не заполнять их каждый раз заново
+static vector<unique_ptr<pawn_table>> PawnTables;
+
+// Стоимость фигур в сотых долях пешки для упорядочивания взятий
+static const int PieceValue[7] = {100, 320, 330, 500, 900, 0, 0};
+
+struct search_state;
+
+// Данные, общие для всех потоков одного поиска
+struct search_shared {
+    chrono::steady_clock::time_point Start; // Время начала поиска
+    search_limits Limits;
+    std::atomic<bool> Abort; // Основной поток завершил поиск, вспомогательные потоки останавливаются
+    search_state* Threads; // Данные всех потоков
+};
+
+// Данные одного потока поиска (Lazy SMP): каждый поток перебирает дерево из той же корневой позиции
+// на собственной копии позиции, общей у потоков является только таблица транспозиций
+struct search_state {
+    int Id = 0; // Номер потока, поток 0 - основной
+    search_shared* Shared = 0;
+    position Pos; // Собственная копия позиции
+    move_list RootMoves; // Ходы из корневой позиции в порядке последней итерации
+    pawn_table* Pawns = 0; // Пешечная таблица потока
+    key_history History; // Ключи позиций партии и текущего варианта перебора
+
+    // Счетчики читаются основным потоком во время поиска, поэтому атомарны
+    std::atomic<uint64_t> Nodes{0}; // Количество просмотренных позиций
+    std::atomic<uint64_t> HashProbes{0}; // Количество обращений к таблице транспозиций
+    std::atomic<uint64_t> HashHits{0}; // Количество найденных в таблице позиций
+
+    chess_move Killers[MaxPly][2] = {}; // Тихие ходы, вызвавшие отсечение, для каждого полухода
+    bool Stopped = false; // Поиск прерван, результат текущей итерации не используется
+
+    // Результат последней завершенной итерации
+    int CompletedDepth = 0;
+    int BestScore = 0;
+    chess_move BestMove = NoMove;
+};
+
+// Увеличение счетчика, который изменяет только один поток. Обходится без дорогой атомарной операции сложения
+static inline void bump (std::atomic<uint64_t>& Counter)
+{
+    Counter.store(Counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Время, прошедшее с начала поиска, в миллисекундах
+static int elapsed (const search_shared& Shared)
+{
+    return int(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - Shared.Start).count());
+}
+
+// Проверка, не пора ли прервать поиск по команде или по истечении времени
+// Время отслеживает только основной поток, вспомогательные останавливаются по его сигналу
+static bool time_over (search_state& S)
+{
+    search_shared& Shared = *S.Shared;
+
+    if (StopSearch.load(memory_order_relaxed) || Shared.Abort.load(memory_order_relaxed))
+        S.Stopped = true;
+    else if (S.Id == 0 && Shared.Limits.MoveTime && elapsed(Shared) >= Shared.Limits.MoveTime)
+        S.Stopped = true;
+    return S.Stopped;
+}
+
+// Оценка ходов для упорядочивания перебора: сначала лучший ход предыдущей итерации,
+// затем взятия без потери материала (ценная жертва дешевой фигурой раньше), затем ходы-убийцы,
+// затем проигрывающие размен взятия, затем остальные
+static void score_moves (const position& Pos, const move_list& List, int* Scores, chess_move First, const search_state& S, int ply)
+{
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = List.Moves[i];
+
+        if (m == First)
+            Scores[i] = 1 << 20;
+        else if (is_promotion(m))
+            Scores[i] = promotion_piece(m) == Queen ? (1 << 17) : -1;
+        else if (move_flags(m) == EnPassant)
+            Scores[i] = (1 << 16) + PieceValue[Pawn] * 8;
+        else if (is_capture(m))
+            Scores[i] = (see(Pos, m) >= 0 ? (1 << 16) : (1 << 14)) + PieceValue[Pos.piece_on(move_to(m))] * 8 - Pos.piece_on(move_from(m));
+        else if (m == S.Killers[ply][0])
+            Scores[i] = (1 << 15);
+        else if (m == S.Killers[ply][1])
+            Scores[i] = (1 << 15) - 1;
+        else
+            Scores[i] = 0;
+    }
+}
+
+// Выбор хода с наибольшей оценкой среди ходов с номерами от i и перестановка его на место i
+static chess_move pick_move (move_list& List, int* Scores, int i)
+{
+    int Best = i;
+
+    for (int j = i + 1; j < List.Count; j++)
+        if (Scores[j] > Scores[Best])
+            Best = j;
+
+    swap(List.Moves[i], List.Moves[Best]);
+    swap(Scores[i], Scores[Best]);
+    return List.Moves[i];
+}
+
+// Запоминание тихого хода, вызвавшего отсечение
+static void update_killers (search_state& S, int ply, chess_move m)
+{
+    if (S.Killers[ply][0] != m){
+        S.Killers[ply][1] = S.Killers[ply][0];
+        S.Killers[ply][0] = m;
+    }
+}
+
+// Оценка мата в таблице хранится относительно текущей позиции, а не корня поиска,
+// чтобы ее можно было использовать при попадании в ту же позицию на другом полуходе
+static inline int score_to_tt (int Score, int ply)
+{
+    if (Score >= MateScore - MaxPly)
+        return Score + ply;
+    if (Score <= -MateScore + MaxPly)
+        return Score - ply;
+    return Score;
+}
+
+static inline int score_from_tt (int Score, int ply)
+{
+    if (Score >= MateScore - MaxPly)
+        return Score - ply;
+    if (Score <= -MateScore + MaxPly)
+        return Score + ply;
+    return Score;
+}
+
+// Форсированный перебор взятий (quiescence search) в листьях основного перебора, чтобы оценка не делалась
+// посреди размена. Ходящий может отказаться от взятий и согласиться со статической оценкой. Взятия,
+// проигрывающие размен, не перебираются. Под шахом перебираются все ходы
+static int quiescence (position& Pos, int ply, int alpha, int beta, search_state& S)
+{
+    move_list List;
+    int Scores[MaxMoves];
+    undo Undo;
+    int Best = -InfiniteScore;
+    bool InCheck = in_check(Pos);
+
+    STAT_COUNT(StatQuiescenceNodes);
+    bump(S.Nodes);
+    if ((S.Nodes.load(memory_order_relaxed) & 1023) == 0 && time_over(S))
+        return 0;
+
+    if (ply >= MaxPly)
+        return evaluate(Pos, *S.Pawns);
+
+    if (InCheck){
+        generate_moves(Pos, List);
+        if (List.Count == 0)
+            return -MateScore + ply;
+    }
+    else{
+        Best = evaluate(Pos, *S.Pawns);
+        if (Best >= beta)
+            return Best;
+        if (Best > alpha)
+            alpha = Best;
+        generate_captures(Pos, List);
+    }
+
+    score_moves(Pos, List, Scores, NoMove, S, ply);
+
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = pick_move(List, Scores, i);
+
+        if (!InCheck && see(Pos, m) < 0)
+            continue;
+
+        make_move(Pos, m, Undo);
+        int Score = -quiescence(Pos, ply + 1, -beta, -alpha, S);
+        unmake_move(Pos, m, Undo);
+
+        if (S.Stopped)
+            return 0;
+
+        if (Score > Best){
+            Best = Score;
+            if (Score > alpha)
+                alpha = Score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+    return Best;
+}
+
+// Перебор negamax с альфа-бета отсечением. Оценка возвращается с точки зрения ходящего игрока
+static int negamax (position& Pos, int depth, int ply, int alpha, int beta, search_state& S)
+{
+    move_list List;
+    int Scores[MaxMoves];
+    undo Undo;
+    tt_data Entry;
+    chess_move HashMove = NoMove;
+    chess_move BestMove = NoMove;
+    int Best = -InfiniteScore;
+    int alphaStart = alpha;
+
+    // На нулевой глубине перебор продолжается только взятиями
+    if (depth == 0)
+        return quiescence(Pos, ply, alpha, beta, S);
+
+    STAT_COUNT(StatNodes);
+    bump(S.Nodes);
+    if ((S.Nodes.load(memory_order_relaxed) & 1023) == 0 && time_over(S))
+        return 0;
+
+    if (ply >= MaxPly)
+        return evaluate(Pos, *S.Pawns);
+
+    // Ничья по правилу 50 ходов, недостатком материала или повторением. В переборе ничьей считается
+    // уже первое повторение: если повторение выгодно, его можно повторить и дальше
+    if (Pos.Rule50 >= 100 || insufficient_material(Pos) || S.History.repetitions(Pos) > 0)
+        return 0;
+
+    // Позиция уже просмотрена на достаточную глубину - результат берется из таблицы транспозиций
+    bump(S.HashProbes);
+    if (TT.probe(Pos.Key, Entry)){
+        bump(S.HashHits);
+        HashMove = Entry.Move;
+
+        if (Entry.Depth >= depth){
+            int Score = score_from_tt(Entry.Score, ply);
+
+            if (Entry.Bound == ExactBound || (Entry.Bound == LowerBound && Score >= beta) || (Entry.Bound == UpperBound && Score <= alpha))
+                return Score;
+        }
+    }
+
+    generate_moves(Pos, List);
+
+    // Нет ходов: мат или пат. Более близкий мат оценивается выше
+    if (List.Count == 0)
+        return in_check(Pos) ? -MateScore + ply : 0;
+
+    score_moves(Pos, List, Scores, HashMove, S, ply);
+
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = pick_move(List, Scores, i);
+        bool Quiet = !is_capture(m) && !is_promotion(m);
+
+        S.History.push(Pos.Key);
+        make_move(Pos, m, Undo);
+        int Score = -negamax(Pos, depth - 1, ply + 1, -beta, -alpha, S);
+        unmake_move(Pos, m, Undo);
+        S.History.pop();
+
+        if (S.Stopped)
+            return 0;
+
+        if (Score > Best){
+            Best = Score;
+            if (Score > alpha){
+                alpha = Score;
+                BestMove = m;
+            }
+            if (alpha >= beta){
+                if (Quiet)
+                    update_killers(S, ply, m);
+                break;
+            }
+        }
+    }
+
+    TT.store(Pos.Key, BestMove, score_to_tt(Best, ply), depth,
+             Best >= beta ? LowerBound : (Best > alphaStart ? ExactBound : UpperBound));
+    return Best;
+}
+
+// Перебор ходов из корневой позиции. BestMove перебирается первым и заменяется лучшим найденным ходом
+static int search_root (position& Pos, move_list& List, int depth, search_state& S, chess_move& BestMove)
+{
+    int Scores[MaxMoves];
+    int alpha = -InfiniteScore;
+    undo Undo;
+
+    score_moves(Pos, List, Scores, BestMove, S, 0);
+
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = pick_move(List, Scores, i);
+
+        S.History.push(Pos.Key);
+        make_move(Pos, m, Undo);
+        int Score = -negamax(Pos, depth - 1, 1, -InfiniteScore, -alpha, S);
+        unmake_move(Pos, m, Undo);
+        S.History.pop();
+
+        if (S.Stopped)
+            return 0;
+
+        if (Score > alpha){
+            alpha = Score;
+            BestMove = m;
+        }
+    }
+
+    TT.store(Pos.Key, BestMove, score_to_tt(alpha, 0), depth, ExactBound);
+    return alpha;
+}
+
+// Сложение результатов основного потока и счетчиков всех потоков
+static void collect_report (const search_shared& Shared, search_report& Result)
+{
+    search_state& Main = Shared.Threads[0];
+
+    Result.Depth = Main.CompletedDepth;
+    Result.Score = Main.BestScore;
+    Result.BestMove = Main.BestMove;
+    Result.Time = elapsed(Shared);
+    Result.Nodes = Result.HashProbes = Result.HashHits = 0;
+    Result.PawnProbes = Result.PawnHits = 0;
+
+    for (int i = 0; i < Shared.Limits.Threads; i++){
+        Result.Nodes += Shared.Threads[i].Nodes.load(memory_order_relaxed);
+        Result.HashProbes += Shared.Threads[i].HashProbes.load(memory_order_relaxed);
+        Result.HashHits += Shared.Threads[i].HashHits.load(memory_order_relaxed);
+        Result.PawnProbes += Shared.Threads[i].Pawns -> Probes.load(memory_order_relaxed);
+        Result.PawnHits += Shared.Threads[i].Pawns -> Hits.load(memory_order_relaxed);
+    }
+    Result.HashFull = TT.hashfull();
+}
+
+// Итеративное углубление в одном потоке
+// Вспомогательные потоки с нечетным номером начинают с глубины 2, чтобы потоки расходились по дереву
+// и заполняли таблицу транспозиций разными позициями. Каждая итерация начинается с лучшего хода предыдущей
+static void iterate (search_state& S, report_function Report)
+{
+    search_shared& Shared = *S.Shared;
+    search_report Result;
+
+    for (int depth = 1 + (S.Id & 1); depth <= Shared.Limits.Depth && depth <= MaxPly; depth++){
+        chess_move BestMove = S.BestMove;
+        int Score = search_root(S.Pos, S.RootMoves, depth, S, BestMove);
+
+        if (S.Stopped)
+            break;
+
+        S.CompletedDepth = depth;
+        S.BestScore = Score;
+        S.BestMove = BestMove;
+
+        if (S.Id != 0)
+            continue;
+
+        collect_report(Shared, Result);
+        if (Report)
+            Report(Result);
+
+        // Новая итерация не начинается, если прошло больше половины отведенного времени
+        if (Shared.Limits.MoveTime && Result.Time >= Shared.Limits.MoveTime / 2)
+            break;
+    }
+}
+
+// Поиск лучшего хода в Limits.Threads потоках
+// Результат берется у основного потока, если только вспомогательный поток не завершил более глубокую итерацию
+search_report think (const position& Root, const search_limits& Limits, report_function Report, const key_history* History)
+{
+    search_shared Shared;
+    search_report Result;
+    int Threads = Limits.Threads < 1 ? 1 : Limits.Threads > MaxThreads ? MaxThreads : Limits.Threads;
+    unique_ptr<search_state[]> States(new search_state[Threads]);
+    vector<thread> Helpers;
+
+    STAT_TIMER(TimerSearch);
+
+    Shared.Start = chrono::steady_clock::now();
+    Shared.Limits = Limits;
+    Shared.Limits.Threads = Threads;
+    Shared.Abort = false;
+    Shared.Threads = States.get();
+    TT.new_search();
+
+    while ((int) PawnTables.size() < Threads)
+        PawnTables.emplace_back(new pawn_table());
+
+    for (int i = 0; i < Threads; i++){
+        PawnTables[i] -> Probes = 0;
+        PawnTables[i] -> Hits = 0;
+        States[i].Pawns = PawnTables[i].get();
+        States[i].Id = i;
+        States[i].Shared = &Shared;
+        States[i].Pos = Root;
+        if (History)
+            States[i].History = *History;
+        generate_moves(Root, States[i].RootMoves);
+    }
+
+    if (States[0].RootMoves.Count == 0)
+        return Result;
+
+    for (int i = 0; i < Threads; i++)
+        States[i].BestMove = States[i].RootMoves.Moves[0];
+
+    // Если система не дает создать поток, поиск идет в уже запущенных
+    // Недозапущенные потоки остаются с нулевой глубиной и не влияют на результат
+    for (int i = 1; i < Threads; i++){
+        try {
+            Helpers.emplace_back(iterate, ref(States[i]), report_function(0));
+        }
+        catch (const system_error&){
+            break;
+        }
+    }
+
+    iterate(States[0], Report);
+
+    Shared.Abort = true;
+    for (auto& Helper : Helpers)
+        Helper.join();
+
+    collect_report(Shared, Result);
+
+    for (int i = 1; i < Threads; i++)
+        if (States[i].CompletedDepth > Result.Depth){
+            Result.Depth = States[i].CompletedDepth;
+            Result.Score = States[i].BestScore;
+            Result.BestMove = States[i].BestMove;
+        }
+
+    return Result;
+}
@@ -0,0 +1,49 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include "Movegen.h"
+
+const int MaxPly = 64; // Наибольшая глубина перебора
+const int MateScore = 32000; // Оценка мата, объявленного на текущем полуходе
+const int InfiniteScore = 32001;
+const int MaxThreads = 256; // Наибольшее количество потоков поиска, у каждого своя пешечная таблица
+
+// Ограничения поиска
+struct search_limits {
+    int Depth = MaxPly; // Наибольшая глубина итеративного углубления
+    int MoveTime = 0; // Время на ход в миллисекундах, 0 - без ограничения по времени
+    int Threads = 1; // Количество потоков поиска
+};
+
+// Результат завершенной итерации поиска
+struct search_report {
+    int Depth = 0; // Достигнутая глубина
+    int Score = 0; // Оценка позиции с точки зрения ходящего игрока, в сотых долях пешки
+    uint64_t Nodes = 0; // Количество просмотренных позиций
+    int Time = 0; // Затраченное время в миллисекундах
+    chess_move BestMove = NoMove; // Лучший найденный ход
+
+    // Статистика таблицы транспозиций
+    uint64_t HashProbes = 0; // Количество обращений к таблице
+    uint64_t HashHits = 0; // Количество найденных в таблице позиций
+    int HashFull = 0; // Заполненность таблицы в тысячных долях
+
+    // Статистика пешечных таблиц всех потоков
+    uint64_t PawnProbes = 0;
+    uint64_t PawnHits = 0;
+};
+
+// Функция вывода результатов после каждой итерации
+typedef void (*report_function) (const search_report& Report);
+
+// Флаг прерывания поиска, может быть выставлен из другого потока
+// Сбрасывается вызывающей стороной до начала поиска: think() его не изменяет, чтобы не потерять команду остановки
+extern std::atomic<bool> StopSearch;
+
+// Поиск лучшего хода перебором альфа-бета с итеративным углублением в Limits.Threads потоках
+// Возвращает результат последней завершенной итерации, Report вызывается из вызывающего потока
+// History - ключи позиций, предшествовавших Pos в партии, для обнаружения повторений
+search_report think (const position& Pos, const search_limits& Limits, report_function Report = 0, const key_history* History = 0);
+
+#endif
@@ -0,0 +1,565 @@
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "Server.h"
+#include "Session.h"
+
+using namespace std;
+
+// Наибольшая длина строки команды: позиция FEN вместе с командой с запасом помещается
+const size_t MaxLine = 512;
+
+// Объем неотправленных ответов, после которого команды соединения не читаются, пока клиент их не заберет
+const size_t MaxPending = 1 << 20;
+
+const int MaxEvents = 256;
+
+// Названия состояний партии в ответах, по номерам game_state
+static const char* StateNames[] = {"playing", "checkmate", "stalemate", "fifty", "repetition", "material"};
+
+// Гистограмма времени обработки запросов в наносекундах
+// Каждая степень двойки делится на 8 интервалов, поэтому процентили определяются с точностью до 12.5%,
+// а память и время добавления не зависят от количества запросов
+class latency_histogram {
+    static const int SubBuckets = 8;
+
+    uint64_t Counts[64 * SubBuckets] = {};
+    uint64_t Total = 0;
+    uint64_t Max = 0;
+
+    // Номер интервала: значения до 8 - каждое в своем, дальше по три старших бита после первой единицы
+    static int bucket (uint64_t ns)
+    {
+        if (ns < SubBuckets)
+            return int(ns);
+
+        int Exponent = 63 - __builtin_clzll(ns);
+        return (Exponent - 2) * SubBuckets + int((ns >> (Exponent - 3)) & (SubBuckets - 1));
+    }
+
+    // Наибольшее значение, попадающее в интервал
+    static uint64_t bucket_limit (int Bucket)
+    {
+        if (Bucket < SubBuckets)
+            return Bucket;
+
+        int Shift = Bucket / SubBuckets - 1;
+        return ((uint64_t(SubBuckets + Bucket % SubBuckets) << Shift) | ((uint64_t(1) << Shift) - 1));
+    }
+
+  public:
+    void add (uint64_t ns)
+    {
+        Counts[bucket(ns)]++;
+        Total++;
+        if (ns > Max)
+            Max = ns;
+    }
+
+    // Время, которое не превышают Percent процентов запросов
+    uint64_t percentile (double Percent) const
+    {
+        uint64_t Target = uint64_t(Total * Percent / 100);
+        uint64_t Count = 0;
+
+        if (Target < 1)
+            Target = 1;
+        for (int i = 0; i < 64 * SubBuckets; i++)
+            if ((Count += Counts[i]) >= Target)
+                return bucket_limit(i) < Max ? bucket_limit(i) : Max;
+        return Max;
+    }
+
+    uint64_t total () const {return Total;}
+    uint64_t max () const {return Max;}
+};
+
+// Соединение с клиентом. Для стандартного ввода и вывода дескрипторы чтения и записи разные
+struct connection {
+    int InFd, OutFd;
+    string In; // Принятые символы после последней полной строки
+    string Out; // Ответы, которые еще не отправлены
+    uint32_t Events = 0; // События, на которые соединение подписано в epoll
+    bool Closing = false; // Команды больше не читаются, соединение закрывается после отправки ответов
+};
+
+// Партии сервера по номерам. Партия не привязана к соединению, открывшему ее: ходы в ней могут делать
+// несколько клиентов, и она сохраняется после разрыва соединения до команды close
+static unordered_map<uint64_t, game_session> Sessions;
+static uint64_t NextId = 1;
+
+static latency_histogram Latency;
+static volatile sig_atomic_t StopServer = 0;
+
+static void stop_handler (int)
+{
+    StopServer = 1;
+}
+
+// Следующее слово строки, Line переходит за него
+static char* next_word (char*& Line)
+{
+    for (; *Line == ' ' || *Line == '\t'; Line++);
+
+    char* Word = Line;
+
+    for (; *Line && *Line != ' ' && *Line != '\t'; Line++);
+    if (*Line)
+        *Line++ = '\0';
+    return Word;
+}
+
+// Партия с номером, записанным в Word, 0 если такой партии нет
+static game_session* find_session (const char* Word)
+{
+    char* End;
+    uint64_t Id = strtoull(Word, &End, 10);
+
+    if (!*Word || *End)
+        return 0;
+
+    auto It = Sessions.find(Id);
+    return It != Sessions.end() ? &It->second : 0;
+}
+
+static void append_percentiles (string& Out)
+{
+    char str[128];
+
+    snprintf(str, sizeof(str), " p50 %.1f p90 %.1f p99 %.1f max %.1f", Latency.percentile(50) / 1e3,
+             Latency.percentile(90) / 1e3, Latency.percentile(99) / 1e3, Latency.max() / 1e3);
+    Out += str;
+}
+
+// Выполнение одной команды протокола, ответ дописывается в очередь соединения
+// Возвращает false для пустой строки, на которую ответа нет
+static bool handle_line (connection& Conn, char* Line, size_t Connections)
+{
+    string& Out = Conn.Out;
+    char str[FENSize];
+    char SAN[SANSize];
+
+    // Строки могут заканчиваться на "\r\n"
+    size_t Length = strlen(Line);
+    if (Length && Line[Length - 1] == '\r')
+        Line[Length - 1] = '\0';
+
+    char* Command = next_word(Line);
+
+    if (!*Command)
+        return false;
+
+    // new [FEN] - новая партия, в ответе ее номер
+    if (!strcmp(Command, "new")){
+        for (; *Line == ' ' || *Line == '\t'; Line++);
+
+        game_session& Session = Sessions[NextId];
+
+        if (!Session.start(*Line ? Line : 0)){
+            Sessions.erase(NextId);
+            Out += "error bad fen\n";
+            return true;
+        }
+        Out += "ok " + to_string(NextId++) + '\n';
+        return true;
+    }
+
+    // stats - количество партий и соединений, запросов и время их обработки в микросекундах
+    if (!strcmp(Command, "stats")){
+        Out += "ok sessions " + to_string(Sessions.size()) + " connections " + to_string(Connections)
+             + " requests " + to_string(Latency.total());
+        append_percentiles(Out);
+        Out += '\n';
+        return true;
+    }
+
+    // quit - закрытие соединения
+    if (!strcmp(Command, "quit")){
+        Out += "ok\n";
+        Conn.Closing = true;
+        return true;
+    }
+
+    // Остальные команды относятся к партии, номер которой идет вторым словом
+    static const char* GameCommands[] = {"move", "undo", "moves", "fen", "state", "history", "close"};
+    bool Known = false;
+
+    for (const char* Name : GameCommands)
+        Known |= !strcmp(Command, Name);
+    if (!Known){
+        Out += "error unknown command\n";
+        return true;
+    }
+
+    char* IdWord = next_word(Line);
+    game_session* Session = find_session(IdWord);
+    string Prefix = string(IdWord) + ' ';
+
+    if (!Session){
+        Out += "error " + Prefix + "unknown game\n";
+        return true;
+    }
+
+    // move <номер> <ход> - ход координатами или в SAN, в ответе ход в обеих записях, состояние и результат партии
+    if (!strcmp(Command, "move")){
+        if (Session->State != GamePlaying){
+            Out += "error " + Prefix + "game over\n";
+            return true;
+        }
+
+        chess_move m = Session->parse_move(next_word(Line));
+
+        if (m == NoMove){
+            Out += "error " + Prefix + "illegal move\n";
+            return true;
+        }
+
+        move_to_SAN (Session->Pos, m, SAN);
+        move_to_string (m, str);
+        Session->play(m);
+
+        Out += "ok " + Prefix + str + ' ' + SAN + ' ' + StateNames[Session->State] + ' ' + Session->Record.Result + '\n';
+        return true;
+    }
+
+    // undo <номер> - отмена последнего хода
+    if (!strcmp(Command, "undo")){
+        if (!Session->take_back())
+            Out += "error " + Prefix + "no moves\n";
+        else
+            Out += "ok " + Prefix + StateNames[Session->State] + ' ' + Session->Record.Result + '\n';
+        return true;
+    }
+
+    // moves <номер> - все легальные ходы координатами
+    if (!strcmp(Command, "moves")){
+        Out += "ok ";
+        Out += IdWord;
+        for (int i = 0; i < Session->Moves.Count; i++){
+            move_to_string (Session->Moves.Moves[i], str);
+            Out += ' ';
+            Out += str;
+        }
+        Out += '\n';
+        return true;
+    }
+
+    // fen <номер> - текущая позиция
+    if (!strcmp(Command, "fen")){
+        to_FEN (Session->Pos, str);
+        Out += "ok " + Prefix + str + '\n';
+        return true;
+    }
+
+    // state <номер> - состояние партии, результат, цвет ходящего игрока и количество сделанных полуходов
+    if (!strcmp(Command, "state")){
+        Out += "ok " + Prefix + StateNames[Session->State] + ' ' + Session->Record.Result
+             + (Session->Pos.CurrentColour == White ? " w " : " b ") + to_string(Session->Record.Moves.size()) + '\n';
+        return true;
+    }
+
+    // history <номер> - все ходы партии координатами
+    if (!strcmp(Command, "history")){
+        Out += "ok ";
+        Out += IdWord;
+        for (chess_move m : Session->Record.Moves){
+            move_to_string (m, str);
+            Out += ' ';
+            Out += str;
+        }
+        Out += '\n';
+        return true;
+    }
+
+    // close <номер> - удаление партии
+    Sessions.erase(strtoull(IdWord, 0, 10));
+    Out += "ok " + string(IdWord) + '\n';
+    return true;
+}
+
+// Чтение доступных данных соединения и выполнение всех полностью принятых команд
+// Время обработки каждой команды отсчитывается от получения данных, поэтому учитывает и ожидание
+// команд, пришедших одним блоком. Возвращает false при ошибке чтения
+static bool read_input (connection& Conn, size_t Connections)
+{
+    char Buffer[1 << 16];
+    ssize_t Length = read(Conn.InFd, Buffer, sizeof(Buffer));
+
+    if (Length < 0)
+        return errno == EAGAIN || errno == EINTR;
+
+    auto Arrival = chrono::steady_clock::now();
+
+    // Конец ввода: последняя строка может быть без перевода строки
+    if (Length == 0){
+        Conn.Closing = true;
+        Conn.In += '\n';
+    }
+    else
+        Conn.In.append(Buffer, Length);
+
+    size_t Start = 0, End;
+
+    while (!StopServer && (End = Conn.In.find('\n', Start)) != string::npos){
+        Conn.In[End] = '\0';
+        if (handle_line (Conn, &Conn.In[Start], Connections))
+            Latency.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - Arrival).count());
+        Start = End + 1;
+
+        if (Conn.Closing){
+            Start = Conn.In.size();
+            break;
+        }
+    }
+    Conn.In.erase(0, Start);
+
+    if (Conn.In.size() > MaxLine){
+        Conn.Out += "error line too long\n";
+        Conn.Closing = true;
+    }
+    return true;
+}
+
+// Отправка очереди ответов, пока клиент принимает данные. Возвращает false при ошибке записи
+static bool write_output (connection& Conn)
+{
+    size_t Sent = 0;
+
+    while (Sent < Conn.Out.size()){
+        ssize_t Length = write(Conn.OutFd, Conn.Out.data() + Sent, Conn.Out.size() - Sent);
+
+        if (Length < 0 && errno == EINTR)
+            continue;
+        if (Length < 0 && errno != EAGAIN)
+            return false;
+        if (Length < 0)
+            break;
+        Sent += Length;
+    }
+    Conn.Out.erase(0, Sent);
+    return true;
+}
+
+// Открытие сокета для приема соединений: порт TCP на 127.0.0.1 или сокет Unix. -1 при ошибке
+static int open_listener (const char* Address, bool& Tcp)
+{
+    int Fd;
+
+    Tcp = Address[0] && strspn(Address, "0123456789") == strlen(Address);
+
+    if (Tcp){
+        sockaddr_in Addr = {};
+        int On = 1;
+
+        Addr.sin_family = AF_INET;
+        Addr.sin_port = htons(atoi(Address));
+        Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        Fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (Fd >= 0)
+            setsockopt(Fd, SOL_SOCKET, SO_REUSEADDR, &On, sizeof(On));
+        if (Fd >= 0 && bind(Fd, (sockaddr*) &Addr, sizeof(Addr)) == 0 && listen(Fd, SOMAXCONN) == 0)
+            return Fd;
+    }
+    else{
+        sockaddr_un Addr = {};
+        struct stat Info;
+
+        if (strlen(Address) >= sizeof(Addr.sun_path))
+            return -1;
+        Addr.sun_family = AF_UNIX;
+        strcpy(Addr.sun_path, Address);
+
+        // Сокет, оставшийся от прошлого запуска, удаляется, любой другой файл - нет
+        if (stat(Address, &Info) == 0 && S_ISSOCK(Info.st_mode))
+            unlink(Address);
+
+        Fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (Fd >= 0 && bind(Fd, (sockaddr*) &Addr, sizeof(Addr)) == 0 && listen(Fd, SOMAXCONN) == 0)
+            return Fd;
+    }
+
+    if (Fd >= 0)
+        close(Fd);
+    return -1;
+}
+
+bool run_server (const char* Address)
+{
+    bool Console = !Address; // Работа через стандартный ввод и вывод
+    bool Tcp = false;
+    int Listener = -1;
+
+    // В режиме стандартного ввода вывод занят протоколом, сообщения сервера идут в поток ошибок
+    ostream& Log = Console ? cerr : cout;
+
+    if (!Console && (Listener = open_listener(Address, Tcp)) < 0){
+        Log << "Не удалось открыть сокет " << Address << ": " << strerror(errno) << '\n';
+        return false;
+    }
+
+    // Запись в закрытое клиентом соединение должна возвращать ошибку, а не завершать программу
+    signal(SIGPIPE, SIG_IGN);
+
+    // Без SA_RESTART сигнал прерывает epoll_wait, и цикл сразу видит флаг остановки
+    struct sigaction Action = {};
+    Action.sa_handler = stop_handler;
+    sigaction(SIGINT, &Action, 0);
+    sigaction(SIGTERM, &Action, 0);
+
+    // Каждое соединение - открытый файл, для тысяч клиентов обычного ограничения в 1024 файла мало
+    rlimit Limit;
+    if (getrlimit(RLIMIT_NOFILE, &Limit) == 0 && Limit.rlim_cur < Limit.rlim_max){
+        Limit.rlim_cur = Limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &Limit);
+    }
+
+    int Epoll = epoll_create1(EPOLL_CLOEXEC);
+    unordered_map<int, connection> Connections; // Соединения по дескриптору чтения
+    epoll_event Events[MaxEvents];
+    epoll_event Event = {};
+
+    Event.events = EPOLLIN;
+    if (Console){
+        connection& Conn = Connections[STDIN_FILENO];
+
+        Conn.InFd = STDIN_FILENO;
+        Conn.OutFd = STDOUT_FILENO;
+        Conn.Events = EPOLLIN;
+        Event.data.fd = STDIN_FILENO;
+
+        // Обычный файл epoll не принимает, но он всегда готов к чтению, поэтому читается без ожидания
+        if (epoll_ctl(Epoll, EPOLL_CTL_ADD, STDIN_FILENO, &Event) < 0){
+            while (!Conn.Closing && read_input(Conn, 1) && write_output(Conn));
+            Connections.clear();
+        }
+    }
+    else{
+        Event.data.fd = Listener;
+        epoll_ctl(Epoll, EPOLL_CTL_ADD, Listener, &Event);
+        Log << "Сервер ожидает соединений: " << (Tcp ? "127.0.0.1:" : "") << Address << '\n';
+        Log.flush();
+    }
+
+    auto Start = chrono::steady_clock::now();
+    bool ListenerPaused = false; // Прием соединений остановлен из-за нехватки дескрипторов
+    bool NoDescriptors = false; // О нехватке дескрипторов уже сообщено
+
+    while (!StopServer && (Listener >= 0 || !Connections.empty())){
+        int Count = epoll_wait(Epoll, Events, MaxEvents, -1);
+
+        if (Count < 0 && errno == EINTR)
+            continue;
+        if (Count < 0)
+            break;
+
+        for (int i = 0; i < Count; i++){
+            int Fd = Events[i].data.fd;
+
+            // Новые соединения принимаются все сразу
+            if (Fd == Listener){
+                int Client;
+
+                while ((Client = accept4(Listener, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+                    connection& Conn = Connections[Client];
+                    int On = 1;
+
+                    // Ответы короткие, и ждать их объединения в один пакет нельзя
+                    if (Tcp)
+                        setsockopt(Client, IPPROTO_TCP, TCP_NODELAY, &On, sizeof(On));
+
+                    Conn.InFd = Conn.OutFd = Client;
+                    Conn.Events = Event.events = EPOLLIN;
+                    Event.data.fd = Client;
+                    epoll_ctl(Epoll, EPOLL_CTL_ADD, Client, &Event);
+                }
+                // Непринятое соединение остается в очереди, и epoll будил бы цикл снова и снова, поэтому сокет
+                // не отслеживается до закрытия какого-нибудь соединения. Сообщение выводится один раз, пока очередь не опустеет
+                if (errno == EMFILE || errno == ENFILE){
+                    if (!NoDescriptors){
+                        Log << "Нет свободных дескрипторов, прием соединений приостановлен" << '\n';
+                        Log.flush();
+                        NoDescriptors = true;
+                    }
+                    Event.events = 0;
+                    Event.data.fd = Listener;
+                    epoll_ctl(Epoll, EPOLL_CTL_MOD, Listener, &Event);
+                    ListenerPaused = true;
+                }
+                else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    NoDescriptors = false;
+                continue;
+            }
+
+            auto It = Connections.find(Fd);
+            if (It == Connections.end())
+                continue;
+
+            connection& Conn = It->second;
+            bool Alive = true;
+
+            if (!Conn.Closing && (Events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                Alive = read_input(Conn, Connections.size());
+            if (Alive)
+                Alive = write_output(Conn);
+
+            if (!Alive || (Conn.Closing && Conn.Out.empty())){
+                epoll_ctl(Epoll, EPOLL_CTL_DEL, Fd, 0);
+                if (!Console)
+                    close(Fd);
+                Connections.erase(It);
+
+                if (ListenerPaused){
+                    Event.events = EPOLLIN;
+                    Event.data.fd = Listener;
+                    epoll_ctl(Epoll, EPOLL_CTL_MOD, Listener, &Event);
+                    ListenerPaused = false;
+                }
+                continue;
+            }
+
+            // Пока клиент не забирает ответы, его команды не читаются; недописанные ответы ждут готовности сокета
+            uint32_t Wanted = (!Conn.Closing && Conn.Out.size() < MaxPending ? uint32_t(EPOLLIN) : 0)
+                            | (Conn.Out.empty() ? 0 : uint32_t(EPOLLOUT));
+
+            if (Wanted != Conn.Events){
+                Conn.Events = Event.events = Wanted;
+                Event.data.fd = Fd;
+                epoll_ctl(Epoll, EPOLL_CTL_MOD, Fd, &Event);
+            }
+        }
+    }
+
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+
+    for (auto& Item : Connections)
+        if (!Console)
+            close(Item.first);
+    if (Listener >= 0)
+        close(Listener);
+    if (Listener >= 0 && !Tcp)
+        unlink(Address);
+    close(Epoll);
+
+    string Percentiles;
+    append_percentiles(Percentiles);
+
+    Log << "Партий: " << Sessions.size() << ", запросов: " << Latency.total() << '\n';
+    Log << "Время: " << int(Seconds * 1000) << " мс" << '\n';
+    Log << "Время обработки запроса, мкс:" << Percentiles << '\n';
+    return true;
+}
@@ -0,0 +1,11 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// Сервер партий: множество одновременных партий в одном процессе, управляемых построчным протоколом
+// Address - номер порта TCP (сервер принимает соединения только с 127.0.0.1), путь к сокету Unix
+// или 0 для работы через стандартный ввод и вывод. Все соединения обслуживаются одним потоком через epoll,
+// на каждую команду отправляется ответ из одной строки. Работает до конца ввода или сигнала SIGINT/SIGTERM
+// Возвращает false, если не удалось открыть сокет
+bool run_server (const char* Address);
+
+#endif
@@ -0,0 +1,106 @@
+#include <cstring>
+#include "Session.h"
+#include "Stats.h"
+
+using namespace std;
+
+bool game_session :: start (const char* FEN)
+{
+    position NewPos;
+
+    if (!load_FEN (NewPos, FEN ? FEN : StartPositionFEN))
+        return false;
+
+    Pos = NewPos;
+    Undo.clear();
+    Record.Moves.clear();
+    Record.ErrorLine = 0;
+
+    // В записи партии позиция хранится в нормализованном виде, начальная расстановка - пустой строкой
+    to_FEN (Pos, Record.FEN);
+    if (!strcmp(Record.FEN, StartPositionFEN))
+        Record.FEN[0] = '\0';
+
+    update();
+    return true;
+}
+
+chess_move game_session :: parse_move (const char* str) const
+{
+    chess_move m = NoMove;
+
+    if (strlen(str) == 4 || strlen(str) == 5)
+        m = string_to_move (Moves, Index, str);
+    if (m == NoMove)
+        m = SAN_to_move (Pos, str);
+    return m;
+}
+
+void game_session :: play (chess_move m)
+{
+    Record.Moves.push_back(m);
+    Undo.emplace_back();
+    make_move (Pos, m, Undo.back());
+    update();
+}
+
+bool game_session :: take_back ()
+{
+    if (Record.Moves.empty())
+        return false;
+
+    unmake_move (Pos, Record.Moves.back(), Undo.back());
+    Record.Moves.pop_back();
+    Undo.pop_back();
+    update();
+    return true;
+}
+
+// Повторения ищутся так же, как в key_history: только среди позиций с тем же игроком на ходу
+// и только после последнего взятия или хода пешкой
+int game_session :: repetitions () const
+{
+    int Count = 0;
+    int Size = Undo.size();
+
+    for (int i = 2; i <= Pos.Rule50 && i <= Size; i += 2)
+        if (Undo[Size - i].Key == Pos.Key)
+            Count++;
+    return Count;
+}
+
+// Если ходов больше, чем вмещает история, берутся последние: для повторений важны только они
+void game_session :: history (key_history& History) const
+{
+    int Size = Undo.size();
+
+    History.Size = 0;
+    for (int i = Size > MaxHistory ? Size - MaxHistory : 0; i < Size; i++)
+        History.push(Undo[i].Key);
+}
+
+void game_session :: update ()
+{
+    STAT_TIMER(TimerTurn);
+
+    generate_moves (Pos, Moves);
+    index_moves (Moves, Index);
+
+    if (Moves.Count == 0)
+        State = in_check(Pos) ? GameCheckmate : GameStalemate;
+    else if (Pos.Rule50 >= 100)
+        State = GameRule50;
+    else if (repetitions() >= 2)
+        State = GameRepetition;
+    else if (insufficient_material(Pos))
+        State = GameNoMaterial;
+    else
+        State = GamePlaying;
+
+    if (State == GamePlaying)
+        strcpy(Record.Result, "*");
+    else if (State == GameCheckmate)
+        strcpy(Record.Result, Pos.CurrentColour == White ? "0-1" : "1-0");
+    else
+        strcpy(Record.Result, "1/2-1/2");
+}
@@ -0,0 +1,48 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <vector>
+#include "Pgn.h"
+
+// Состояние партии: идет или закончена и по какой причине
+enum game_state {GamePlaying, GameCheckmate, GameStalemate, GameRule50, GameRepetition, GameNoMaterial};
+
+// Партия: текущая позиция, список ее легальных ходов, запись партии и данные для отмены ходов
+// Партия не использует глобальных данных, поэтому в одной программе может идти сколько угодно партий
+// Ключи позиций для обнаружения повторений берутся из данных отмены, где они уже хранятся, так что
+// отдельная история ключей не нужна и партия занимает около килобайта плюс 24 байта на ход
+struct game_session {
+    position Pos;
+    pgn_game Record; // Начальная позиция, сделанные ходы и результат
+
+    // Список всех доступных ходов текущего игрока, упорядоченный по исходным клеткам
+    move_list Moves;
+    move_index Index;
+
+    std::vector<undo> Undo; // Данные для отмены каждого хода из записи партии
+    game_state State = GamePlaying;
+
+    // Начало новой партии из позиции FEN, без FEN - из начальной расстановки
+    // Возвращает false, если позиция неправильная, партия тогда остается прежней
+    bool start (const char* FEN = 0);
+
+    // Поиск легального хода, записанного координатами ("e2e4", "e7e8q") или в SAN ("Nf3", "O-O"), NoMove если хода нет
+    chess_move parse_move (const char* str) const;
+
+    // Совершение хода с добавлением в запись партии. Ход должен быть из списка Moves
+    void play (chess_move m);
+
+    // Отмена последнего хода, false если ходов в записи нет
+    bool take_back ();
+
+    // Сколько раз текущая позиция уже встречалась в партии
+    int repetitions () const;
+
+    // Ключи позиций партии перед каждым ходом, для поиска хода компьютера
+    void history (key_history& History) const;
+
+  private:
+    void update (); // Построение списка ходов и проверка окончания партии после изменения позиции
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstdlib>
+#include "Stats.h"
+
+#ifdef CHESS_STATS
+
+#include <mutex>
+
+using namespace std;
+
+static const char* CounterNames[StatCounterCount] = {
+    "generate", "moves_generated", "check_evasions", "double_checks", "pinned_pieces", "king_move_tests",
+    "square_attacked", "make_move", "see", "evaluate", "nodes", "quiescence_nodes"
+};
+
+static const char* TimerNames[TimerCount] = {"turn", "generate", "evaluate", "search"};
+
+thread_local stat_block ThreadStats;
+
+// Сумма статистики завершившихся потоков
+static mutex TotalsMutex;
+static uint64_t TotalCounters[StatCounterCount];
+static uint64_t TotalCalls[TimerCount];
+static uint64_t TotalNanoseconds[TimerCount];
+
+static bool JsonReport;
+
+stat_block :: ~stat_block ()
+{
+    lock_guard<mutex> Lock(TotalsMutex);
+
+    for (int i = 0; i < StatCounterCount; i++)
+        TotalCounters[i] += Counters[i];
+    for (int i = 0; i < TimerCount; i++){
+        TotalCalls[i] += Calls[i];
+        TotalNanoseconds[i] += Nanoseconds[i];
+    }
+}
+
+// Вывод статистики. Вызывается после завершения всех потоков, включая главный, поэтому блокировка не нужна
+static void print_stats ()
+{
+    if (JsonReport){
+        printf("{\"counters\": {");
+        for (int i = 0; i < StatCounterCount; i++)
+            printf("%s\"%s\": %llu", i ? ", " : "", CounterNames[i], (unsigned long long) TotalCounters[i]);
+        printf("}, \"timers\": {");
+        for (int i = 0; i < TimerCount; i++)
+            printf("%s\"%s\": {\"calls\": %llu, \"ns\": %llu}", i ? ", " : "", TimerNames[i],
+                   (unsigned long long) TotalCalls[i], (unsigned long long) TotalNanoseconds[i]);
+        printf("}}\n");
+        return;
+    }
+
+    // Заголовки выровнены вручную: printf отсчитывает ширину в байтах, а не в буквах кириллицы
+    printf("\nСчетчик                      Значение\n");
+    for (int i = 0; i < StatCounterCount; i++)
+        printf("%-20s %16llu\n", CounterNames[i], (unsigned long long) TotalCounters[i]);
+
+    printf("\nТаймер                    Вызовов     Всего мс     нс/вызов\n");
+    for (int i = 0; i < TimerCount; i++)
+        printf("%-20s %12llu %12.1f %12.1f\n", TimerNames[i], (unsigned long long) TotalCalls[i], TotalNanoseconds[i] / 1e6,
+               TotalCalls[i] ? double(TotalNanoseconds[i]) / TotalCalls[i] : 0.0);
+}
+
+void report_stats_at_exit (bool Json)
+{
+    JsonReport = Json;
+    atexit(print_stats);
+}
+
+#else
+
+void report_stats_at_exit (bool)
+{
+    printf("Статистика недоступна: программа собрана без CHESS_STATS\n");
+}
+
+#endif
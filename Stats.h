@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+
+// Счетчики и таймеры горячих участков программы для поиска узких мест
+// Включаются при сборке с макросом CHESS_STATS, без него макросы STAT_* раскрываются в пустые выражения
+// и не вычисляют даже свои аргументы, так что обычная сборка ничего не теряет
+
+// Счетчики событий
+enum stat_counter {
+    StatGenerate, // Построения списка ходов
+    StatMovesGenerated, // Построенные ходы
+    StatCheckEvasions, // Построения ходов под шахом, когда ходы ограничиваются взятием или закрытием
+    StatDoubleChecks, // Двойные шахи, когда возможны только ходы короля
+    StatPinnedPieces, // Найденные связанные фигуры
+    StatKingMoveTests, // Проверки клеток для хода короля
+    StatSquareAttacked, // Вызовы square_attacked()
+    StatMakeMove, // Сделанные ходы
+    StatSee, // Оценки размена
+    StatEvaluate, // Статические оценки
+    StatNodes, // Узлы основного перебора
+    StatQuiescenceNodes, // Узлы перебора взятий
+    StatCounterCount
+};
+
+// Таймеры участков: количество входов и суммарное время. Время вложенных участков входит во внешние
+enum stat_timer {
+    TimerTurn, // Подготовка хода в партии: список ходов и проверка конца игры
+    TimerGenerate, // Построение списка ходов
+    TimerEvaluate, // Статическая оценка
+    TimerSearch, // Поиск лучшего хода целиком
+    TimerCount
+};
+
+// Вывод собранной статистики при завершении программы в виде таблицы или JSON
+// Если программа собрана без CHESS_STATS, сразу выводится сообщение об этом
+void report_stats_at_exit (bool Json);
+
+#ifdef CHESS_STATS
+
+#include <chrono>
+
+// Статистика одного потока. Потоки считают независимо, без синхронизации, и добавляют свои значения
+// к общим при завершении
+struct stat_block {
+    uint64_t Counters[StatCounterCount] = {};
+    uint64_t Calls[TimerCount] = {};
+    uint64_t Nanoseconds[TimerCount] = {};
+
+    ~stat_block ();
+};
+
+extern thread_local stat_block ThreadStats;
+
+// Замер времени от создания до выхода из области видимости
+class stat_scope {
+    stat_timer Timer;
+    std::chrono::steady_clock::time_point Start;
+
+  public:
+    explicit stat_scope (stat_timer t) : Timer(t), Start(std::chrono::steady_clock::now()) {}
+    ~stat_scope ()
+    {
+        ThreadStats.Calls[Timer]++;
+        ThreadStats.Nanoseconds[Timer] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count();
+    }
+};
+
+#define STAT_COUNT(Counter) (ThreadStats.Counters[Counter]++)
+#define STAT_ADD(Counter, Value) (ThreadStats.Counters[Counter] += (Value))
+#define STAT_TIMER(Timer) stat_scope StatScope(Timer)
+
+#else
+
+#define STAT_COUNT(Counter) ((void) 0)
+#define STAT_ADD(Counter, Value) ((void) 0)
+#define STAT_TIMER(Timer) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+#include <new>
+#include "TT.h"
+
+using namespace std;
+
+transposition_table TT;
+
+// Упаковка и распаковка слова данных записи
+static inline uint64_t pack_data (chess_move Move, int Score, int Depth, int Bound, int Generation)
+{
+    return uint64_t(Move) | uint64_t(uint16_t(int16_t(Score))) << 16 | uint64_t(uint8_t(Depth)) << 32
+         | uint64_t(Bound) << 40 | uint64_t(Generation) << 42;
+}
+
+static inline int data_depth (uint64_t Data) {return int(uint8_t(Data >> 32));}
+static inline int data_generation (uint64_t Data) {return int(Data >> 42) & 63;}
+
+// Выделение памяти под таблицу. Количество корзин не обязано быть степенью двойки
+// Старая таблица освобождается только после успешного выделения новой, иначе она остается прежней
+bool transposition_table :: resize (int MegaBytes)
+{
+    uint64_t NewCount = (uint64_t(MegaBytes) << 20) / sizeof(tt_bucket);
+    if (NewCount == 0)
+        NewCount = 1;
+
+    tt_bucket* NewBuckets = new (nothrow) tt_bucket[NewCount];
+    if (!NewBuckets)
+        return false;
+
+    delete[] Buckets;
+    Buckets = NewBuckets;
+    Count = NewCount;
+    clear();
+    return true;
+}
+
+void transposition_table :: clear ()
+{
+    for (uint64_t i = 0; i < Count; i++)
+        for (int j = 0; j < BucketSize; j++){
+            Buckets[i].Entries[j].Check.store(0, memory_order_relaxed);
+            Buckets[i].Entries[j].Data.store(0, memory_order_relaxed);
+        }
+    Generation = 0;
+}
+
+// Поиск записи по ключу
+bool transposition_table :: probe (uint64_t Key, tt_data& Result) const
+{
+    tt_bucket& Bucket = bucket(Key);
+
+    for (int i = 0; i < BucketSize; i++){
+        uint64_t Data = Bucket.Entries[i].Data.load(memory_order_relaxed);
+        uint64_t Check = Bucket.Entries[i].Check.load(memory_order_relaxed);
+
+        if ((Check ^ Data) == Key && Data){
+            Result.Move = chess_move(Data);
+            Result.Score = int16_t(Data >> 16);
+            Result.Depth = data_depth(Data);
+            Result.Bound = int(Data >> 40) & 3;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Сохранение результата. Запись с тем же ключом перезаписывается, иначе вытесняется
+// запись, оставшаяся от прошлых поисков или имеющая наименьшую глубину
+void transposition_table :: store (uint64_t Key, chess_move Move, int Score, int Depth, int Bound)
+{
+    tt_bucket& Bucket = bucket(Key);
+    tt_entry* Replace = &Bucket.Entries[0];
+    int ReplaceWorth = 1 << 30;
+
+    for (int i = 0; i < BucketSize; i++){
+        tt_entry& Entry = Bucket.Entries[i];
+        uint64_t Data = Entry.Data.load(memory_order_relaxed);
+
+        if ((Entry.Check.load(memory_order_relaxed) ^ Data) == Key || !Data){
+            // Лучший ход позиции сохраняется, если новый результат хода не содержит
+            if (Move == NoMove && Data)
+                Move = chess_move(Data);
+            Replace = &Entry;
+            break;
+        }
+
+        int Worth = data_depth(Data) - 8 * ((Generation - data_generation(Data)) & 63);
+        if (Worth < ReplaceWorth){
+            ReplaceWorth = Worth;
+            Replace = &Entry;
+        }
+    }
+
+    uint64_t Data = pack_data(Move, Score, Depth, Bound, Generation);
+    Replace -> Check.store(Key ^ Data, memory_order_relaxed);
+    Replace -> Data.store(Data, memory_order_relaxed);
+}
+
+// Доля записей текущего поиска среди первых тысячи корзин
+int transposition_table :: hashfull () const
+{
+    int Used = 0;
+    uint64_t Sample = Count < 1000 ? Count : 1000;
+
+    for (uint64_t i = 0; i < Sample; i++)
+        for (int j = 0; j < BucketSize; j++){
+            uint64_t Data = Buckets[i].Entries[j].Data.load(memory_order_relaxed);
+            if (Data && data_generation(Data) == Generation)
+                Used++;
+        }
+    return Sample ? int(Used * 1000 / (Sample * BucketSize)) : 0;
+}
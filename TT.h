@@ -0,0 +1,65 @@
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include "Position.h"
+
+// Наибольший размер таблицы в мегабайтах
+const int MaxHashSize = 65536;
+
+// Тип оценки, сохраненной в таблице: точная, верхняя или нижняя граница
+enum bound_type {NoBound, UpperBound, LowerBound, ExactBound};
+
+// Запись таблицы - два 64-битных слова
+// Data: ход (16 бит) | оценка (16 бит) | глубина (8 бит) | тип оценки (2 бита) | поколение (6 бит)
+// Check = Key ^ Data: если другой поток успел изменить одно из слов, запись не пройдет проверку ключа,
+// поэтому запись и чтение обходятся без блокировок
+struct tt_entry {
+    std::atomic<uint64_t> Check;
+    std::atomic<uint64_t> Data;
+};
+
+// Корзина из четырех записей занимает ровно одну строку кэша
+const int BucketSize = 4;
+
+struct alignas(64) tt_bucket {
+    tt_entry Entries[BucketSize];
+};
+
+// Распакованное содержимое записи
+struct tt_data {
+    chess_move Move;
+    int Score;
+    int Depth;
+    int Bound;
+};
+
+// Таблица транспозиций - кэш результатов поиска, общий для всех потоков
+class transposition_table {
+    tt_bucket* Buckets = 0;
+    uint64_t Count = 0; // Количество корзин
+    uint8_t Generation = 0; // Номер текущего поиска, записи прошлых поисков вытесняются в первую очередь
+
+    tt_bucket& bucket (uint64_t Key) const {return Buckets[(unsigned __int128) Key * Count >> 64];}
+
+  public:
+    ~transposition_table () {delete[] Buckets;}
+
+    // Выделение памяти под таблицу заданного размера в мегабайтах
+    // Возвращает false, если памяти не хватило, прежняя таблица тогда сохраняется
+    bool resize (int MegaBytes);
+    void clear (); // Очистка всех записей
+    void new_search () {Generation = (Generation + 1) & 63;}
+
+    // Поиск записи по ключу, возвращает false, если позиции в таблице нет
+    bool probe (uint64_t Key, tt_data& Result) const;
+    // Сохранение результата поиска позиции
+    void store (uint64_t Key, chess_move Move, int Score, int Depth, int Bound);
+
+    int hashfull () const; // Заполненность таблицы записями текущего поиска, в тысячных долях
+    int size_MB () const {return int(Count * sizeof(tt_bucket) >> 20);}
+};
+
+extern transposition_table TT;
+
+#endif
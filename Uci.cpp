@@ -0,0 +1,238 @@
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <system_error>
+#include <chrono>
+#include <cstring>
+#include "Uci.h"
+#include "Movegen.h"
+#include "Search.h"
+#include "TT.h"
+
+using namespace std;
+
+// Вывод из потока поиска и из потока чтения команд не должен перемешиваться
+static mutex OutputLock;
+
+static void send (const string& Line)
+{
+    lock_guard<mutex> Lock(OutputLock);
+    cout << Line << endl;
+}
+
+// Оценка в формате UCI: в сотых долях пешки или количество ходов до мата
+static string score_string (int Score)
+{
+    if (Score >= MateScore - MaxPly)
+        return "mate " + to_string((MateScore - Score + 1) / 2);
+    if (Score <= -MateScore + MaxPly)
+        return "mate " + to_string(-(MateScore + Score) / 2);
+    return "cp " + to_string(Score);
+}
+
+// Вывод строки info после каждой итерации поиска
+static void send_info (const search_report& Report)
+{
+    char str[6];
+
+    move_to_string(Report.BestMove, str);
+    send("info depth " + to_string(Report.Depth) + " score " + score_string(Report.Score)
+         + " nodes " + to_string(Report.Nodes) + " nps " + to_string(Report.Nodes * 1000 / (Report.Time > 0 ? Report.Time : 1))
+         + " time " + to_string(Report.Time) + " hashfull " + to_string(Report.HashFull) + " pv " + str);
+}
+
+// Поиск в отдельном потоке. При неограниченном поиске (go infinite) ход сообщается только после stop
+static void search_thread (position Pos, search_limits Limits, bool Infinite, const key_history* History)
+{
+    char str[6] = "0000";
+    search_report Result;
+
+    // Нехватка памяти под пешечные таблицы или стеки потоков не должна завершать программу:
+    // оболочка получает сообщение и пустой ход
+    try {
+        Result = think(Pos, Limits, send_info, History);
+    }
+    catch (const exception& Error){
+        send(string("info string search failed: ") + Error.what());
+    }
+
+    while (Infinite && !StopSearch.load())
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    if (Result.BestMove != NoMove)
+        move_to_string(Result.BestMove, str);
+    send(string("bestmove ") + str);
+}
+
+// Команда position: startpos или fen <FEN>, затем необязательный список ходов moves <ход> ...
+// Ключи позиций перед каждым ходом записываются в History для обнаружения повторений
+static void set_position (position& Pos, key_history& History, istringstream& Input)
+{
+    string Token, FEN;
+
+    History.Size = 0;
+
+    Input >> Token;
+    if (Token == "startpos"){
+        FEN = StartPositionFEN;
+        Input >> Token;
+    }
+    else if (Token == "fen")
+        while (Input >> Token && Token != "moves")
+            FEN += Token + " ";
+    else
+        return;
+
+    if (!load_FEN(Pos, FEN.c_str())){
+        send("info string invalid fen");
+        load_FEN(Pos, StartPositionFEN);
+        return;
+    }
+
+    // Ходы после позиции записаны в формате "e2e4"
+    while (Input >> Token){
+        move_list List;
+        move_index Index;
+
+        generate_moves(Pos, List);
+        index_moves(List, Index);
+        chess_move m = Token.size() >= 4 ? string_to_move(List, Index, Token.c_str()) : NoMove;
+
+        if (m == NoMove){
+            send("info string illegal move " + Token);
+            return;
+        }
+        History.push(Pos.Key);
+        make_move(Pos, m);
+    }
+}
+
+// Команда go: ограничения поиска по глубине, времени на ход или оставшемуся времени партии
+// При игре на время на ход отводится доля оставшегося времени с частью добавки, но не больше,
+// чем можно потратить без риска просрочки
+static search_limits go_limits (const position& Pos, istringstream& Input, int Threads, bool& Infinite)
+{
+    search_limits Limits;
+    string Token;
+    int Time[2] = {0, 0}, Increment[2] = {0, 0}, MovesToGo = 0;
+
+    Limits.Threads = Threads;
+    Infinite = false;
+
+    while (Input >> Token){
+        if (Token == "depth")
+            Input >> Limits.Depth;
+        else if (Token == "movetime")
+            Input >> Limits.MoveTime;
+        else if (Token == "wtime")
+            Input >> Time[White];
+        else if (Token == "btime")
+            Input >> Time[Black];
+        else if (Token == "winc")
+            Input >> Increment[White];
+        else if (Token == "binc")
+            Input >> Increment[Black];
+        else if (Token == "movestogo")
+            Input >> MovesToGo;
+        else if (Token == "infinite")
+            Infinite = true;
+    }
+
+    int Left = Time[Pos.CurrentColour];
+    if (!Limits.MoveTime && Left > 0){
+        Limits.MoveTime = Left / (MovesToGo > 0 ? MovesToGo + 1 : 30) + Increment[Pos.CurrentColour] * 3 / 4;
+        if (Limits.MoveTime > Left - 50)
+            Limits.MoveTime = Left - 50;
+        if (Limits.MoveTime < 1)
+            Limits.MoveTime = 1;
+    }
+
+    if (Limits.Depth < 1 || Limits.Depth > MaxPly)
+        Limits.Depth = MaxPly;
+    return Limits;
+}
+
+// Остановка текущего поиска с ожиданием завершения потока
+static void stop_search (thread& Searcher)
+{
+    if (Searcher.joinable()){
+        StopSearch = true;
+        Searcher.join();
+    }
+}
+
+void uci_loop (int Threads, const char* FirstCommand)
+{
+    position Pos;
+    key_history History;
+    thread Searcher;
+    string Line, Command;
+
+    load_FEN(Pos, StartPositionFEN);
+    if (FirstCommand)
+        Line = FirstCommand;
+
+    while (FirstCommand || getline(cin, Line)){
+        istringstream Input(Line);
+
+        FirstCommand = 0;
+        Command.clear();
+        Input >> Command;
+
+        if (Command == "uci"){
+            send("id name Console-Chess");
+            send("id author evenrevenn");
+            send("option name Hash type spin default " + to_string(TT.size_MB()) + " min 1 max " + to_string(MaxHashSize));
+            send("option name Threads type spin default " + to_string(Threads) + " min 1 max " + to_string(MaxThreads));
+            send("uciok");
+        }
+        else if (Command == "isready")
+            send("readyok");
+        else if (Command == "ucinewgame"){
+            stop_search(Searcher);
+            TT.clear();
+        }
+        else if (Command == "setoption"){
+            string Token, Name;
+            int Value = 0;
+
+            // setoption name <имя> value <значение>
+            Input >> Token >> Name >> Token >> Value;
+            stop_search(Searcher);
+            // Значения вне объявленных в ответе на uci пределов приводятся к ближайшей границе
+            if (Name == "Hash" && !TT.resize(max(1, min(Value, MaxHashSize))))
+                send("info string not enough memory for Hash " + to_string(Value) + ", keeping " + to_string(TT.size_MB()) + " MB");
+            if (Name == "Threads")
+                Threads = max(1, min(Value, MaxThreads));
+        }
+        else if (Command == "position"){
+            stop_search(Searcher);
+            set_position(Pos, History, Input);
+        }
+        else if (Command == "go"){
+            bool Infinite;
+
+            stop_search(Searcher);
+            search_limits Limits = go_limits(Pos, Input, Threads, Infinite);
+
+            // Флаг сбрасывается до запуска потока, чтобы команда stop, пришедшая сразу после go, не потерялась
+            StopSearch = false;
+            try {
+                Searcher = thread(search_thread, Pos, Limits, Infinite, &History);
+            }
+            catch (const system_error& Error){
+                send(string("info string search failed: ") + Error.what());
+                send("bestmove 0000");
+            }
+        }
+        else if (Command == "stop")
+            stop_search(Searcher);
+        else if (Command == "quit")
+            break;
+    }
+
+    stop_search(Searcher);
+}
@@ -0,0 +1,10 @@
+#ifndef UCI_H
+#define UCI_H
+
+// Работа по протоколу UCI (Universal Chess Interface) для подключения к шахматным оболочкам
+// Команды читаются со стандартного ввода до команды quit или конца ввода, поиск выполняется в отдельном
+// потоке, поэтому команды stop и isready обрабатываются во время поиска без задержки
+// Если FirstCommand задан, он обрабатывается до чтения ввода (например, уже прочитанная команда "uci")
+void uci_loop (int Threads, const char* FirstCommand = 0);
+
+#endif
@@ -0,0 +1,353 @@
+// Набор микробенчмарков для измерения скорости основных операций над позицией
+// Каждый тест многократно прогоняется по набору стандартных позиций, пока не пройдет заданное время,
+// и выводит время одной операции в наносекундах и количество выделений памяти на операцию
+//
+// Использование: chess_bench [часть имени теста] [--time <мс на тест>] [--baseline <файл>]
+// С параметром --baseline результаты сравниваются с сохраненным ранее выводом программы
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <memory>
+#include "Position.h"
+#include "Movegen.h"
+#include "Notation.h"
+#include "Eval.h"
+
+using namespace std;
+
+// Подсчет выделений памяти: глобальные операторы new заменяются счетчиком поверх malloc
+// GCC считает free() для памяти из operator new ошибкой, не учитывая, что операторы заменены
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static atomic<uint64_t> Allocations{0};
+
+void* operator new (size_t Size)
+{
+    Allocations++;
+    if (void* p = malloc(Size ? Size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void* operator new[] (size_t Size)
+{
+    return operator new(Size);
+}
+
+void operator delete (void* p) noexcept {free(p);}
+void operator delete[] (void* p) noexcept {free(p);}
+void operator delete (void* p, size_t) noexcept {free(p);}
+void operator delete[] (void* p, size_t) noexcept {free(p);}
+
+// Стандартные позиции для проверки генераторов ходов: начальная, "Kiwipete", эндшпили с взятием на проходе,
+// позиции с превращениями и рокировками, а также несколько обычных позиций миттельшпиля
+static const char* Corpus[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r2q1rk1/pp2bppp/2n1bn2/2pp4/3P4/2NBPN2/PP3PPP/R1BQ1RK1 w - - 0 9",
+    "2r2rk1/pp3ppp/2n1pn2/q2p4/3P4/P1PBPN2/5PPP/R2Q1RK1 b - - 2 15",
+    "8/5pk1/6p1/p2P4/P1p2K2/2P3P1/8/8 w - - 0 45",
+    "4rrk1/pbq2ppp/1pn1p3/2p5/2PP4/P1QBPN2/5PPP/R4RK1 w - - 1 16",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"
+};
+
+const int CorpusSize = sizeof(Corpus) / sizeof(Corpus[0]);
+
+// Позиции корпуса и списки их ходов, подготовленные один раз до измерений
+static position Positions[CorpusSize];
+static move_list Moves[CorpusSize];
+static pawn_table* Pawns;
+
+// Результат, который зависит от всех вычислений теста, чтобы компилятор не выбросил их как ненужные
+static volatile uint64_t Sink;
+
+// Один проход теста по корпусу, возвращает количество выполненных операций
+typedef uint64_t (*bench_pass) ();
+
+static uint64_t bench_generate_moves ()
+{
+    move_list List;
+    uint64_t Count = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        generate_moves(Positions[i], List);
+        Count += List.Count;
+    }
+    Sink += Count;
+    return CorpusSize;
+}
+
+static uint64_t bench_generate_captures ()
+{
+    move_list List;
+    uint64_t Count = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        generate_captures(Positions[i], List);
+        Count += List.Count;
+    }
+    Sink += Count;
+    return CorpusSize;
+}
+
+// Проверка шаха каждой стороне: король ходящего игрока и король соперника
+static uint64_t bench_in_check ()
+{
+    uint64_t Count = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        const position& Pos = Positions[i];
+
+        Count += in_check(Pos);
+        Count += square_attacked(Pos, Pos.king_square(opposite(Pos.CurrentColour)), Pos.CurrentColour);
+    }
+    Sink += Count;
+    return CorpusSize * 2;
+}
+
+// Атакованность всех клеток доски: основа проверки полей рокировки и ходов короля
+static uint64_t bench_square_attacked ()
+{
+    uint64_t Count = 0;
+
+    for (int i = 0; i < CorpusSize; i++)
+        for (int sq = 0; sq < 64; sq++)
+            Count += square_attacked(Positions[i], sq, opposite(Positions[i].CurrentColour));
+    Sink += Count;
+    return CorpusSize * 64;
+}
+
+// Выполнение и отмена каждого легального хода
+static uint64_t bench_make_unmake ()
+{
+    uint64_t Count = 0, Keys = 0;
+    undo Undo;
+
+    for (int i = 0; i < CorpusSize; i++){
+        position& Pos = Positions[i];
+
+        for (int j = 0; j < Moves[i].Count; j++){
+            make_move(Pos, Moves[i].Moves[j], Undo);
+            Keys ^= Pos.Key;
+            unmake_move(Pos, Moves[i].Moves[j], Undo);
+        }
+        Count += Moves[i].Count;
+    }
+    Sink += Keys;
+    return Count;
+}
+
+static uint64_t bench_see ()
+{
+    uint64_t Count = 0;
+    int Total = 0;
+
+    for (int i = 0; i < CorpusSize; i++)
+        for (int j = 0; j < Moves[i].Count; j++)
+            if (is_capture(Moves[i].Moves[j])){
+                Total += see(Positions[i], Moves[i].Moves[j]);
+                Count++;
+            }
+    Sink += Total;
+    return Count;
+}
+
+static uint64_t bench_evaluate ()
+{
+    int Total = 0;
+
+    for (int i = 0; i < CorpusSize; i++)
+        Total += evaluate(Positions[i], *Pawns);
+    Sink += Total;
+    return CorpusSize;
+}
+
+static uint64_t bench_load_FEN ()
+{
+    position Pos;
+    uint64_t Keys = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        load_FEN(Pos, Corpus[i]);
+        Keys ^= Pos.Key;
+    }
+    Sink += Keys;
+    return CorpusSize;
+}
+
+static uint64_t bench_to_FEN ()
+{
+    char FEN[FENSize];
+    uint64_t Length = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        to_FEN(Positions[i], FEN);
+        Length += strlen(FEN);
+    }
+    Sink += Length;
+    return CorpusSize;
+}
+
+static uint64_t bench_pack_unpack ()
+{
+    packed_position Packed;
+    position Pos;
+    uint64_t Keys = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        pack_position(Positions[i], Packed);
+        unpack_position(Pos, Packed);
+        Keys ^= Pos.Key;
+    }
+    Sink += Keys;
+    return CorpusSize;
+}
+
+// Запись каждого легального хода в SAN и обратный разбор
+static uint64_t bench_SAN ()
+{
+    char SAN[SANSize];
+    uint64_t Count = 0, Found = 0;
+
+    for (int i = 0; i < CorpusSize; i++){
+        for (int j = 0; j < Moves[i].Count; j++){
+            move_to_SAN(Positions[i], Moves[i].Moves[j], SAN);
+            Found += SAN_to_move(Positions[i], SAN);
+        }
+        Count += Moves[i].Count;
+    }
+    Sink += Found;
+    return Count;
+}
+
+// Полный перебор на три полухода из каждой позиции, операция - одна конечная позиция
+static uint64_t bench_perft ()
+{
+    uint64_t Nodes = 0;
+
+    for (int i = 0; i < CorpusSize; i++)
+        Nodes += perft(Positions[i], 3);
+    Sink += Nodes;
+    return Nodes;
+}
+
+struct bench_case {
+    const char* Name;
+    bench_pass Pass;
+};
+
+static const bench_case Cases[] = {
+    {"generate_moves", bench_generate_moves},
+    {"generate_captures", bench_generate_captures},
+    {"in_check", bench_in_check},
+    {"square_attacked", bench_square_attacked},
+    {"make_unmake", bench_make_unmake},
+    {"see", bench_see},
+    {"evaluate", bench_evaluate},
+    {"load_FEN", bench_load_FEN},
+    {"to_FEN", bench_to_FEN},
+    {"pack_unpack", bench_pack_unpack},
+    {"SAN", bench_SAN},
+    {"perft", bench_perft}
+};
+
+// Время одной операции теста из сохраненного вывода программы, 0 если теста там нет
+static double baseline_time (const char* FileName, const char* Name)
+{
+    FILE* File = fopen(FileName, "r");
+    char Line[256], CaseName[64];
+    double Time;
+
+    if (!File)
+        return 0;
+    while (fgets(Line, sizeof(Line), File))
+        if (sscanf(Line, "%63s %lf", CaseName, &Time) == 2 && !strcmp(CaseName, Name)){
+            fclose(File);
+            return Time;
+        }
+    fclose(File);
+    return 0;
+}
+
+int main (int argc, char* argv[])
+{
+    const char* Filter = 0;
+    const char* Baseline = 0;
+    int TimeLimit = 500;
+
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--time") && i + 1 < argc)
+            TimeLimit = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+            Baseline = argv[++i];
+        else
+            Filter = argv[i];
+    }
+
+    init_bitboards();
+    init_zobrist();
+    init_eval();
+
+    unique_ptr<pawn_table> PawnTable(new pawn_table());
+    Pawns = PawnTable.get();
+
+    for (int i = 0; i < CorpusSize; i++){
+        if (!load_FEN(Positions[i], Corpus[i])){
+            cout << "Неправильная позиция FEN: " << Corpus[i] << '\n';
+            return 1;
+        }
+        generate_moves(Positions[i], Moves[i]);
+    }
+
+    // Заголовок начинается с '#', чтобы при сравнении с сохраненным выводом он пропускался
+    // Ширина колонок подобрана вручную: setw считает байты, а не буквы кириллицы
+    cout << "# тест                   нс/опер      операций  выдел/опер" << (Baseline ? "   разница" : "") << '\n';
+
+    for (const bench_case& Case : Cases){
+        if (Filter && !strstr(Case.Name, Filter))
+            continue;
+
+        // Разогрев кэшей и пешечной таблицы одним проходом
+        Case.Pass();
+
+        uint64_t Operations = 0;
+        uint64_t StartAllocations = Allocations;
+        auto Start = chrono::steady_clock::now();
+        double Seconds;
+
+        do
+            Operations += Case.Pass();
+        while ((Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count()) * 1000 < TimeLimit);
+
+        double Time = Operations ? Seconds * 1e9 / Operations : 0;
+        double AllocationsPerOp = Operations ? double(Allocations - StartAllocations) / Operations : 0;
+
+        cout << left << setw(20) << Case.Name << right << fixed << setprecision(2) << setw(12) << Time
+             << setw(14) << Operations << setw(12) << setprecision(3) << AllocationsPerOp;
+
+        // Разница с базовым прогоном в процентах: отрицательная - операция стала быстрее
+        if (Baseline){
+            double Old = baseline_time(Baseline, Case.Name);
+            if (Old > 0)
+                cout << setw(9) << setprecision(1) << showpos << (Time - Old) * 100 / Old << '%' << noshowpos;
+            else
+                cout << setw(10) << "-";
+        }
+        cout << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,495 @@
+// Дифференциальная проверка генератора ходов
+// Из стандартных позиций играются случайные партии, и в каждой позиции список легальных ходов программы
+// сравнивается со списком, построенным независимым эталонным генератором на доске 0x88. Время от времени
+// сравниваются и результаты perft. Кроме того, проверяются хеш-ключи, шах, запись ходов в SAN,
+// а также FEN и упаковка позиции туда и обратно
+//
+// Использование: chess_fuzz [число партий] [начальное значение генератора] [--perft <глубина>]
+// При сборке с CHESS_LIBFUZZER вместо main() определяется точка входа libFuzzer: первый байт входных данных
+// выбирает начальную позицию, каждый следующий - очередной ход партии
+
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "Position.h"
+#include "Movegen.h"
+#include "Notation.h"
+
+using namespace std;
+
+// Эталонный генератор: доска 0x88, фигуры хранятся числами со знаком цвета, легальность хода проверяется
+// выполнением хода на копии доски. Он намеренно не использует ничего из программы, кроме разбора аргументов,
+// и написан как можно проще, чтобы ошибки двух генераторов не могли совпасть
+
+enum ref_piece {RefEmpty, RefPawn, RefKnight, RefBishop, RefRook, RefQueen, RefKing};
+
+struct ref_position {
+    int Board[128]; // Фигура на клетке: положительная - белая, отрицательная - черная
+    int Side; // 1 - ходят белые, -1 - черные
+    bool Castle[4]; // Рокировки: белые в короткую и в длинную, черные в короткую и в длинную
+    int Ep; // Поле взятия на проходе, -1 если его нет
+};
+
+struct ref_move {
+    int From, To; // Клетки доски 0x88
+    int Promotion; // Фигура превращения или RefEmpty
+};
+
+static const int KnightSteps[8] = {33, 31, 18, 14, -33, -31, -18, -14};
+static const int KingSteps[8] = {1, -1, 16, -16, 17, 15, -17, -15};
+
+static inline int to88 (int sq) {return (sq >> 3) * 16 + (sq & 7);}
+static inline int from88 (int sq) {return (sq >> 4) * 8 + (sq & 15);}
+static inline bool on_board (int sq) {return !(sq & 0x88);}
+
+static bool ref_load (ref_position& P, const char* FEN)
+{
+    int Rank = 7, File = 0;
+
+    memset(&P, 0, sizeof(P));
+    P.Ep = -1;
+
+    for (; *FEN && *FEN != ' '; FEN++){
+        if (*FEN == '/'){
+            Rank--;
+            File = 0;
+        }
+        else if (*FEN >= '1' && *FEN <= '8')
+            File += *FEN - '0';
+        else{
+            const char* p = strchr(" pnbrqk", *FEN | 32);
+
+            if (!p || Rank < 0 || File > 7)
+                return false;
+            P.Board[Rank * 16 + File] = int(p - " pnbrqk") * (*FEN < 'a' ? 1 : -1);
+            File++;
+        }
+    }
+
+    if (*FEN++ != ' ')
+        return false;
+    P.Side = *FEN == 'b' ? -1 : 1;
+
+    for (FEN += 2; *FEN && *FEN != ' '; FEN++)
+        if (const char* p = strchr("KQkq", *FEN))
+            P.Castle[p - "KQkq"] = true;
+
+    if (*FEN == ' ' && FEN[1] >= 'a' && FEN[1] <= 'h')
+        P.Ep = (FEN[2] - '1') * 16 + (FEN[1] - 'a');
+
+    // Права на рокировку без короля или ладьи на исходных клетках не действуют
+    const int Rooks[4] = {7, 0, 119, 112};
+    for (int i = 0; i < 4; i++)
+        if (P.Board[i < 2 ? 4 : 116] != (i < 2 ? RefKing : -RefKing) || P.Board[Rooks[i]] != (i < 2 ? RefRook : -RefRook))
+            P.Castle[i] = false;
+    return true;
+}
+
+// Атакована ли клетка фигурами цвета By
+static bool ref_attacked (const ref_position& P, int sq, int By)
+{
+    // Белая пешка бьет вверх, поэтому клетку атакует белая пешка, стоящая ниже нее
+    int PawnFrom[2] = {sq - By * 15, sq - By * 17};
+    for (int from : PawnFrom)
+        if (on_board(from) && P.Board[from] == By * RefPawn)
+            return true;
+
+    for (int Step : KnightSteps)
+        if (on_board(sq + Step) && P.Board[sq + Step] == By * RefKnight)
+            return true;
+
+    for (int i = 0; i < 8; i++){
+        int Step = KingSteps[i];
+        int Slider = i < 4 ? RefRook : RefBishop;
+
+        if (on_board(sq + Step) && P.Board[sq + Step] == By * RefKing)
+            return true;
+
+        for (int to = sq + Step; on_board(to); to += Step){
+            if (P.Board[to] == By * Slider || P.Board[to] == By * RefQueen)
+                return true;
+            if (P.Board[to])
+                break;
+        }
+    }
+    return false;
+}
+
+static int ref_king (const ref_position& P, int Side)
+{
+    for (int sq = 0; sq < 128; sq++)
+        if (on_board(sq) && P.Board[sq] == Side * RefKing)
+            return sq;
+    return -1;
+}
+
+static void ref_make (ref_position& P, const ref_move& m)
+{
+    int Piece = P.Board[m.From];
+
+    // Взятие на проходе: взятая пешка стоит рядом с клеткой назначения
+    if (abs(Piece) == RefPawn && m.To == P.Ep)
+        P.Board[m.To - P.Side * 16] = RefEmpty;
+
+    // Рокировка: ладья перепрыгивает через короля
+    if (abs(Piece) == RefKing && m.To - m.From == 2){
+        P.Board[m.From + 1] = P.Board[m.From + 3];
+        P.Board[m.From + 3] = RefEmpty;
+    }
+    if (abs(Piece) == RefKing && m.From - m.To == 2){
+        P.Board[m.From - 1] = P.Board[m.From - 4];
+        P.Board[m.From - 4] = RefEmpty;
+    }
+
+    P.Board[m.To] = m.Promotion ? P.Side * m.Promotion : Piece;
+    P.Board[m.From] = RefEmpty;
+
+    // Рокировки теряются при ходе короля или ладьи и при взятии ладьи на исходной клетке
+    const int Corners[4][2] = {{4, 7}, {4, 0}, {116, 119}, {116, 112}};
+    for (int i = 0; i < 4; i++)
+        for (int sq : Corners[i])
+            if (m.From == sq || m.To == sq)
+                P.Castle[i] = false;
+
+    P.Ep = abs(Piece) == RefPawn && abs(m.To - m.From) == 32 ? (m.From + m.To) / 2 : -1;
+    P.Side = -P.Side;
+}
+
+static void ref_add (const ref_position& P, vector<ref_move>& Moves, int From, int To, int Promotion = RefEmpty)
+{
+    ref_position Next = P;
+    ref_move m = {From, To, Promotion};
+
+    ref_make(Next, m);
+    if (!ref_attacked(Next, ref_king(Next, P.Side), Next.Side))
+        Moves.push_back(m);
+}
+
+static void ref_generate (const ref_position& P, vector<ref_move>& Moves)
+{
+    int Us = P.Side;
+
+    Moves.clear();
+    for (int from = 0; from < 128; from++){
+        if (!on_board(from) || P.Board[from] * Us <= 0)
+            continue;
+
+        int Piece = abs(P.Board[from]);
+
+        if (Piece == RefPawn){
+            int Forward = from + Us * 16;
+            int LastRank = Us > 0 ? 7 : 0;
+
+            if (on_board(Forward) && !P.Board[Forward]){
+                if ((Forward >> 4) == LastRank)
+                    for (int n = RefQueen; n >= RefKnight; n--)
+                        ref_add(P, Moves, from, Forward, n);
+                else
+                    ref_add(P, Moves, from, Forward);
+
+                if ((from >> 4) == (Us > 0 ? 1 : 6) && !P.Board[Forward + Us * 16])
+                    ref_add(P, Moves, from, Forward + Us * 16);
+            }
+
+            for (int Side = -1; Side <= 1; Side += 2){
+                int to = Forward + Side;
+
+                if (!on_board(to))
+                    continue;
+                if (P.Board[to] * Us < 0){
+                    if ((to >> 4) == LastRank)
+                        for (int n = RefQueen; n >= RefKnight; n--)
+                            ref_add(P, Moves, from, to, n);
+                    else
+                        ref_add(P, Moves, from, to);
+                }
+                else if (to == P.Ep && P.Board[to - Us * 16] == -Us * RefPawn)
+                    ref_add(P, Moves, from, to);
+            }
+            continue;
+        }
+
+        if (Piece == RefKnight || Piece == RefKing){
+            for (int i = 0; i < 8; i++){
+                int to = from + (Piece == RefKnight ? KnightSteps[i] : KingSteps[i]);
+
+                if (on_board(to) && P.Board[to] * Us <= 0)
+                    ref_add(P, Moves, from, to);
+            }
+            continue;
+        }
+
+        for (int i = Piece == RefBishop ? 4 : 0; i < (Piece == RefRook ? 4 : 8); i++)
+            for (int to = from + KingSteps[i]; on_board(to) && P.Board[to] * Us <= 0; to += KingSteps[i]){
+                ref_add(P, Moves, from, to);
+                if (P.Board[to])
+                    break;
+            }
+    }
+
+    // Рокировки: король и ладья на местах, между ними пусто, король не под шахом и не проходит через битое поле
+    int Home = Us > 0 ? 4 : 116;
+    int Short = Us > 0 ? 0 : 2;
+
+    if (P.Board[Home] != Us * RefKing || ref_attacked(P, Home, -Us))
+        return;
+    if (P.Castle[Short] && P.Board[Home + 3] == Us * RefRook && !P.Board[Home + 1] && !P.Board[Home + 2]
+        && !ref_attacked(P, Home + 1, -Us))
+        ref_add(P, Moves, Home, Home + 2);
+    if (P.Castle[Short + 1] && P.Board[Home - 4] == Us * RefRook && !P.Board[Home - 1] && !P.Board[Home - 2]
+        && !P.Board[Home - 3] && !ref_attacked(P, Home - 1, -Us))
+        ref_add(P, Moves, Home, Home - 2);
+}
+
+static uint64_t ref_perft (const ref_position& P, int depth)
+{
+    vector<ref_move> Moves;
+    uint64_t Nodes = 0;
+
+    ref_generate(P, Moves);
+    if (depth <= 1)
+        return depth == 1 ? Moves.size() : 1;
+
+    for (const ref_move& m : Moves){
+        ref_position Next = P;
+
+        ref_make(Next, m);
+        Nodes += ref_perft(Next, depth - 1);
+    }
+    return Nodes;
+}
+
+// Сравнение двух генераторов
+
+// Ход в общем для обоих генераторов виде: клетки 0..63 и фигура превращения
+static inline int move_key (int from, int to, int Promotion)
+{
+    return from | (to << 6) | (Promotion << 12);
+}
+
+static const char* Corpus[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    "8/8/8/2k5/3Pp3/8/8/4K2R b K d3 0 1",
+    "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1",
+    "4k3/8/8/K2pP2q/8/8/8/8 w - d6 0 2"
+};
+
+const int CorpusSize = sizeof(Corpus) / sizeof(Corpus[0]);
+
+static int PerftDepth = 2; // Глубина perft для сравнения, 0 - не сравнивать
+static uint64_t PositionsChecked = 0, MovesChecked = 0, PerftNodes = 0;
+
+// Сообщение о расхождении с позицией и последовательностью ходов, приведшей к ней
+static void report_mismatch (const char* What, const char* StartFEN, const vector<chess_move>& Played, const position& Pos)
+{
+    char FEN[FENSize], str[6];
+
+    to_FEN(Pos, FEN);
+    cout << "Расхождение: " << What << '\n' << "Позиция: " << FEN << '\n' << "Начальная позиция: " << StartFEN << '\n' << "Ходы:";
+    for (chess_move m : Played){
+        move_to_string(m, str);
+        cout << ' ' << str;
+    }
+    cout << '\n';
+}
+
+// Проверка позиции обоими генераторами. Возвращает false при расхождении
+static bool check_position (position& Pos, const ref_position& Ref, const move_list& List, const char* StartFEN,
+                            const vector<chess_move>& Played, bool Perft)
+{
+    vector<ref_move> RefMoves;
+    vector<int> Ours, Theirs;
+    char SAN[SANSize], FEN[FENSize], str[6];
+
+    PositionsChecked++;
+    ref_generate(Ref, RefMoves);
+
+    for (int i = 0; i < List.Count; i++){
+        chess_move m = List.Moves[i];
+        Ours.push_back(move_key(move_from(m), move_to(m), is_promotion(m) ? promotion_piece(m) + 1 : 0));
+    }
+    for (const ref_move& m : RefMoves)
+        Theirs.push_back(move_key(from88(m.From), from88(m.To), m.Promotion));
+    sort(Ours.begin(), Ours.end());
+    sort(Theirs.begin(), Theirs.end());
+    MovesChecked += Ours.size();
+
+    if (Ours != Theirs){
+        report_mismatch("списки ходов", StartFEN, Played, Pos);
+        cout << "Программа:";
+        for (int i = 0; i < List.Count; i++){
+            move_to_string(List.Moves[i], str);
+            cout << ' ' << str;
+        }
+        cout << '\n' << "Эталон:";
+        for (const ref_move& m : RefMoves){
+            move_to_string(encode_move(from88(m.From), from88(m.To), m.Promotion ? Promotion | (m.Promotion - 2) : 0), str);
+            cout << ' ' << str;
+        }
+        cout << '\n';
+        return false;
+    }
+
+    if (in_check(Pos) != ref_attacked(Ref, ref_king(Ref, Ref.Side), -Ref.Side)){
+        report_mismatch("шах", StartFEN, Played, Pos);
+        return false;
+    }
+
+    if (Pos.Key != compute_key(Pos) || Pos.PawnKey != compute_pawn_key(Pos)){
+        report_mismatch("хеш-ключ", StartFEN, Played, Pos);
+        return false;
+    }
+
+    // FEN и упакованная запись должны восстанавливать ту же позицию с тем же ключом
+    position Copy;
+    packed_position Packed;
+
+    to_FEN(Pos, FEN);
+    if (!load_FEN(Copy, FEN) || Copy.Key != Pos.Key){
+        report_mismatch("FEN", StartFEN, Played, Pos);
+        return false;
+    }
+    if (!pack_position(Pos, Packed) || !unpack_position(Copy, Packed) || Copy.Key != Pos.Key){
+        report_mismatch("упаковка", StartFEN, Played, Pos);
+        return false;
+    }
+
+    for (int i = 0; i < List.Count; i++){
+        move_to_SAN(Pos, List.Moves[i], SAN);
+        if (SAN_to_move(Pos, SAN) != List.Moves[i]){
+            report_mismatch(SAN, StartFEN, Played, Pos);
+            return false;
+        }
+    }
+
+    if (Perft && PerftDepth > 0){
+        uint64_t Nodes = perft(Pos, PerftDepth);
+
+        PerftNodes += Nodes;
+        if (Nodes != ref_perft(Ref, PerftDepth)){
+            report_mismatch("perft", StartFEN, Played, Pos);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Партия из позиции корпуса, ходы выбираются функцией Choose(номер полухода, число ходов)
+// Возвращает false при расхождении генераторов
+template <class chooser>
+static bool play_game (const char* StartFEN, int MaxPlies, chooser Choose)
+{
+    position Pos;
+    ref_position Ref;
+    move_list List;
+    vector<chess_move> Played;
+
+    if (!load_FEN(Pos, StartFEN) || !ref_load(Ref, StartFEN)){
+        cout << "Неправильная позиция FEN: " << StartFEN << '\n';
+        return false;
+    }
+
+    for (int ply = 0; ply < MaxPlies; ply++){
+        generate_moves(Pos, List);
+
+        // perft дорог, поэтому сравнивается не в каждой позиции
+        if (!check_position(Pos, Ref, List, StartFEN, Played, ply % 8 == 0))
+            return false;
+        if (List.Count == 0 || Pos.Rule50 >= 100)
+            break;
+
+        int Choice = Choose(ply, List.Count);
+        if (Choice < 0)
+            break;
+
+        chess_move m = List.Moves[Choice];
+        ref_move r = {to88(move_from(m)), to88(move_to(m)), is_promotion(m) ? promotion_piece(m) + 1 : RefEmpty};
+
+        Played.push_back(m);
+        make_move(Pos, m);
+        ref_make(Ref, r);
+    }
+    return true;
+}
+
+static void init ()
+{
+    init_bitboards();
+    init_zobrist();
+}
+
+#ifdef CHESS_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t* Data, size_t Size)
+{
+    static bool Initialized = false;
+
+    if (!Initialized){
+        init();
+        Initialized = true;
+    }
+    if (Size == 0)
+        return 0;
+
+    auto Choose = [&](int ply, int Count) {return size_t(ply) + 1 < Size ? Data[ply + 1] % Count : -1;};
+
+    if (!play_game(Corpus[Data[0] % CorpusSize], int(Size) - 1, Choose))
+        abort();
+    return 0;
+}
+
+#else
+
+int main (int argc, char* argv[])
+{
+    int Games = 1000;
+    uint64_t Seed = 1;
+    int ArgIndex = 0;
+
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--perft") && i + 1 < argc)
+            PerftDepth = atoi(argv[++i]);
+        else if (ArgIndex++ == 0)
+            Games = atoi(argv[i]);
+        else
+            Seed = strtoull(argv[i], 0, 10);
+    }
+
+    init();
+
+    // Генератор xorshift64: одинаковое начальное значение дает одинаковые партии
+    uint64_t State = Seed ? Seed : 1;
+    auto Choose = [&](int, int Count) {
+        State ^= State << 13;
+        State ^= State >> 7;
+        State ^= State << 17;
+        return int(State % uint64_t(Count));
+    };
+
+    auto Start = chrono::steady_clock::now();
+
+    for (int Game = 0; Game < Games; Game++)
+        if (!play_game(Corpus[Game % CorpusSize], 400, Choose)){
+            cout << "Партия " << Game + 1 << ", начальное значение " << Seed << '\n';
+            return 1;
+        }
+
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+
+    cout << "Партий: " << Games << ", позиций: " << PositionsChecked << ", ходов: " << MovesChecked
+         << ", позиций perft: " << PerftNodes << '\n';
+    cout << "Расхождений нет, время: " << int(Seconds * 1000) << " мс" << '\n';
+    return 0;
+}
+
+#endif